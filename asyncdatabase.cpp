@@ -0,0 +1,147 @@
+#include "asyncdatabase.h"
+#include <QAtomicInt>
+#include <QDebug>
+#include <utility>
+
+AsyncDatabase::AsyncDatabase(const QString& databasePath, QObject *parent)
+    : QObject(parent), m_context(new QObject), m_manager(nullptr)
+{
+    // Connection names must be unique per process
+    static QAtomicInt instanceCounter;
+    m_connectionName = QString("medicare-worker-%1").arg(instanceCounter.fetchAndAddRelaxed(1));
+
+    m_thread.setObjectName("DatabaseWorker");
+    m_context->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+
+    auto opened = std::make_shared<QPromise<bool>>();
+    opened->start();
+    m_opened = opened->future();
+
+    // The connection has to be opened, and the schema migrated, on the thread that will use it
+    QMetaObject::invokeMethod(m_context, [this, databasePath, opened]() {
+        // An empty path resolves to the default database file, on a connection of our own
+        m_manager = new DatabaseManager(m_connectionName, databasePath);
+        const bool ok = m_manager->initDatabase();
+        if (!ok) {
+            qDebug() << "Database worker failed to open" << m_manager->databasePath();
+        }
+        opened->addResult(ok);
+        opened->finish();
+        // Read the changed rows here so the UI thread never queries for them
+        connect(m_manager, &DatabaseManager::medicinesChanged, m_context, [this](MedicineChangeSet changes) {
+            m_manager->loadMedicines(changes.rows, changes.inserted + changes.updated);
+            emit medicinesChanged(changes);
+        });
+    }, Qt::QueuedConnection);
+}
+
+AsyncDatabase::~AsyncDatabase()
+{
+    for (const auto& cancelPending : std::as_const(m_pending)) cancelPending();
+
+    QMetaObject::invokeMethod(m_context, [this]() {
+        // Give this counter's reserved stock back to the other terminals
+        if (m_manager) m_manager->releaseAllHolds();
+        delete m_manager;
+        m_manager = nullptr;
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }, Qt::BlockingQueuedConnection);
+
+    m_thread.quit();
+    m_thread.wait();
+}
+
+QFuture<QList<QVariantList>> AsyncDatabase::getAllMedicines()
+{
+    return run([](DatabaseManager& db) { return db.getAllMedicines(); });
+}
+
+QFuture<CheckoutResult> AsyncDatabase::createInvoice(const QList<QPair<int, int>>& cartItems)
+{
+    return run([cartItems](DatabaseManager& db) {
+        CheckoutResult result;
+        result.invoiceId = db.createInvoice(cartItems, &result.shortMedicineIds);
+        return result;
+    });
+}
+
+QFuture<StockHold> AsyncDatabase::holdStock(int medicineId, int quantity)
+{
+    return run([=](DatabaseManager& db) { return db.holdStock(medicineId, quantity); });
+}
+
+QFuture<bool> AsyncDatabase::releaseStock(int medicineId)
+{
+    return run([=](DatabaseManager& db) { return db.releaseStock(medicineId); });
+}
+
+QFuture<bool> AsyncDatabase::releaseAllHolds()
+{
+    return run([](DatabaseManager& db) { return db.releaseAllHolds(); });
+}
+
+QFuture<bool> AsyncDatabase::addMedicine(const QString& name, const QString& batchNumber, const QString& expiryDate, int quantity, double price)
+{
+    return run([=](DatabaseManager& db) { return db.addMedicine(name, batchNumber, expiryDate, quantity, price); });
+}
+
+QFuture<bool> AsyncDatabase::updateMedicine(int id, const QString& name, const QString& batch, const QString& expiry, int readQty, int qty, double price)
+{
+    return run([=](DatabaseManager& db) { return db.updateMedicine(id, name, batch, expiry, readQty, qty, price); });
+}
+
+QFuture<bool> AsyncDatabase::updateMedicineQuantity(int medicineId, int quantityToSubtract)
+{
+    return run([=](DatabaseManager& db) { return db.updateMedicineQuantity(medicineId, quantityToSubtract); });
+}
+
+QFuture<bool> AsyncDatabase::addStock(int id, int quantityToAdd)
+{
+    return run([=](DatabaseManager& db) { return db.addStock(id, quantityToAdd); });
+}
+
+QFuture<GoodsReceiptResult> AsyncDatabase::receiveGoods(const QList<ReceiptLine>& lines)
+{
+    return run([lines](DatabaseManager& db) { return db.receiveGoods(lines); });
+}
+
+QFuture<bool> AsyncDatabase::deleteMedicine(int id)
+{
+    return run([=](DatabaseManager& db) { return db.deleteMedicine(id); });
+}
+
+QFuture<QList<QVariantList>> AsyncDatabase::getInvoices(const QString& supersedeKey)
+{
+    return run([](DatabaseManager& db) { return db.getInvoices(); }, supersedeKey);
+}
+
+QFuture<QList<InvoiceSummary>> AsyncDatabase::getInvoicePage(const InvoiceFilter& filter, const InvoiceSummary& after, int limit,
+                                                             const QString& supersedeKey)
+{
+    return run([=](DatabaseManager& db) { return db.getInvoicePage(filter, after, limit); }, supersedeKey);
+}
+
+QFuture<QList<QVariantList>> AsyncDatabase::getInvoiceDetails(qint64 invoiceId, const QString& supersedeKey)
+{
+    return run([invoiceId](DatabaseManager& db) { return db.getInvoiceDetails(invoiceId); }, supersedeKey);
+}
+
+QFuture<QHash<qint64, QList<QVariantList>>> AsyncDatabase::getInvoiceDetails(const QList<qint64>& invoiceIds,
+                                                                             const QString& supersedeKey)
+{
+    return run([invoiceIds](DatabaseManager& db) { return db.getInvoiceDetails(invoiceIds); }, supersedeKey);
+}
+
+void AsyncDatabase::cancel(const QString& supersedeKey)
+{
+    auto cancelPending = m_pending.take(supersedeKey);
+    if (cancelPending) cancelPending();
+}
+
+void AsyncDatabase::supersede(const QString& key, std::function<void()> cancelPrevious)
+{
+    cancel(key);
+    m_pending.insert(key, std::move(cancelPrevious));
+}
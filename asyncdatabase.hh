@@ -0,0 +1,110 @@
+#ifndef ASYNCDATABASE_H
+#define ASYNCDATABASE_H
+
+#include <QObject>
+#include <QThread>
+#include <QFuture>
+#include <QPromise>
+#include <QHash>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include "databasemanager.h"
+
+// Invoice ID (-1 if the sale was refused) and the lines that were short
+struct CheckoutResult
+{
+    qint64 invoiceId = -1;
+    QList<int> shortMedicineIds;
+};
+
+// Runs DatabaseManager calls on a dedicated worker thread that owns its own
+// SQLite connection, so the GUI thread never waits on the disk.
+//
+// Every call returns a QFuture; attach a continuation with
+// future.then(this, [](T result) { ... }) to get the result back on the UI
+// thread. Calls made with a supersede key cancel the previous pending call
+// with the same key; a cancelled call is skipped if it has not started yet
+// and its continuation never runs either way.
+class AsyncDatabase : public QObject
+{
+    Q_OBJECT
+
+public:
+    // An empty databasePath opens the same file as the default DatabaseManager
+    explicit AsyncDatabase(const QString& databasePath = QString(), QObject *parent = nullptr);
+    ~AsyncDatabase();
+
+    // Finishes with true once the worker has opened the database and run the
+    // schema migrations. Calls made before that simply queue behind it.
+    QFuture<bool> opened() const { return m_opened; }
+
+    // Mirrors of the DatabaseManager API
+    QFuture<QList<QVariantList>> getAllMedicines();
+    QFuture<CheckoutResult> createInvoice(const QList<QPair<int, int>>& cartItems);
+    QFuture<StockHold> holdStock(int medicineId, int quantity);
+    QFuture<bool> releaseStock(int medicineId);
+    QFuture<bool> releaseAllHolds();
+    QFuture<bool> addMedicine(const QString& name, const QString& batchNumber, const QString& expiryDate, int quantity, double price);
+    QFuture<bool> updateMedicine(int id, const QString& name, const QString& batch, const QString& expiry, int readQty, int qty, double price);
+    QFuture<bool> updateMedicineQuantity(int medicineId, int quantityToSubtract);
+    QFuture<bool> addStock(int id, int quantityToAdd);
+    QFuture<GoodsReceiptResult> receiveGoods(const QList<ReceiptLine>& lines);
+    QFuture<bool> deleteMedicine(int id);
+    QFuture<QList<QVariantList>> getInvoices(const QString& supersedeKey = QString());
+    QFuture<QList<InvoiceSummary>> getInvoicePage(const InvoiceFilter& filter, const InvoiceSummary& after, int limit,
+                                                  const QString& supersedeKey = QString());
+    QFuture<QList<QVariantList>> getInvoiceDetails(qint64 invoiceId, const QString& supersedeKey = QString());
+    QFuture<QHash<qint64, QList<QVariantList>>> getInvoiceDetails(const QList<qint64>& invoiceIds,
+                                                                  const QString& supersedeKey = QString());
+
+    // Runs fn(DatabaseManager&) on the worker thread. fn must not touch UI objects.
+    template <typename Fn>
+    auto run(Fn fn, const QString& supersedeKey = QString()) -> QFuture<std::invoke_result_t<Fn, DatabaseManager&>>;
+
+    // Cancels the pending call registered under supersedeKey, if any
+    void cancel(const QString& supersedeKey);
+
+signals:
+    // Re-emitted on the UI thread for writes made through this object, with
+    // changes.rows already read on the worker
+    void medicinesChanged(const MedicineChangeSet& changes);
+
+private:
+    void supersede(const QString& key, std::function<void()> cancelPrevious);
+
+    QThread m_thread;
+    QObject *m_context;            // lives in m_thread; queued calls are posted to it
+    DatabaseManager *m_manager;    // created, used and destroyed in m_thread only
+    QString m_connectionName;
+    QFuture<bool> m_opened;
+    QHash<QString, std::function<void()>> m_pending; // supersede key -> cancel
+};
+
+template <typename Fn>
+auto AsyncDatabase::run(Fn fn, const QString& supersedeKey) -> QFuture<std::invoke_result_t<Fn, DatabaseManager&>>
+{
+    using Result = std::invoke_result_t<Fn, DatabaseManager&>;
+
+    auto promise = std::make_shared<QPromise<Result>>();
+    promise->start();
+    QFuture<Result> future = promise->future();
+    if (!supersedeKey.isEmpty()) {
+        supersede(supersedeKey, [future]() mutable { future.cancel(); });
+    }
+
+    QMetaObject::invokeMethod(m_context, [this, promise, fn = std::move(fn)]() mutable {
+        if (!promise->isCanceled() && m_manager) {
+            if constexpr (std::is_void_v<Result>) {
+                fn(*m_manager);
+            } else {
+                promise->addResult(fn(*m_manager));
+            }
+        }
+        promise->finish();
+    }, Qt::QueuedConnection);
+
+    return future;
+}
+
+#endif // ASYNCDATABASE_H
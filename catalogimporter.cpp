@@ -0,0 +1,306 @@
+#include "catalogimporter.h"
+#include "money.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFuture>
+#include <QLocale>
+#include <QQueue>
+#include <QSqlDatabase>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+
+// Where each required field sits in a catalog line
+struct ColumnMap
+{
+    int name = -1;
+    int batch = -1;
+    int expiry = -1;
+    int quantity = -1;
+    int price = -1;
+
+    bool isValid() const { return name >= 0 && batch >= 0 && expiry >= 0 && quantity >= 0 && price >= 0; }
+    int lastIndex() const { return std::max({name, batch, expiry, quantity, price}); }
+};
+
+// One block of the file after the pool has parsed it
+struct ParsedBlock
+{
+    QList<MedicineRecord> records;
+    QStringList errors;
+    qint64 bytes = 0;
+    int rows = 0;
+    int rejected = 0;
+};
+
+// Calls fn(fields, line) for every CSV record in text (RFC 4180 quoting).
+// line is the physical line the record starts on, counting from firstLine.
+template <typename Fn>
+void forEachRecord(const QString& text, int firstLine, Fn fn)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    int line = firstLine;
+    int recordLine = firstLine;
+    auto endRecord = [&]() {
+        fields.append(field);
+        field.clear();
+        // Blank lines are not records
+        if (fields.size() > 1 || !fields.first().trimmed().isEmpty()) fn(fields, recordLine);
+        fields.clear();
+    };
+
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const QChar c = text.at(i);
+        if (quoted) {
+            if (c == QLatin1Char('"')) {
+                if (i + 1 < text.size() && text.at(i + 1) == QLatin1Char('"')) {
+                    field.append(c);
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                if (c == QLatin1Char('\n')) ++line;
+                field.append(c);
+            }
+        } else if (c == QLatin1Char('"')) {
+            quoted = true;
+        } else if (c == QLatin1Char(',')) {
+            fields.append(field);
+            field.clear();
+        } else if (c == QLatin1Char('\n')) {
+            endRecord();
+            recordLine = ++line;
+        } else if (c != QLatin1Char('\r')) {
+            field.append(c);
+        }
+    }
+    if (!field.isEmpty() || !fields.isEmpty()) endRecord();
+}
+
+ColumnMap mapColumns(const QStringList& header)
+{
+    ColumnMap columns;
+    for (int i = 0; i < header.size(); ++i) {
+        const QString name = header.at(i).trimmed().toCaseFolded();
+        if (name == "name") columns.name = i;
+        else if (name == "batch" || name == "batchnumber") columns.batch = i;
+        else if (name == "expiry" || name == "expirydate") columns.expiry = i;
+        else if (name == "quantity" || name == "qty") columns.quantity = i;
+        else if (name == "price") columns.price = i;
+    }
+    return columns;
+}
+
+// Index just past the last line break outside a quoted field, or -1 if there is none
+qsizetype recordBoundary(const QByteArray& data)
+{
+    const char *bytes = data.constData();
+    bool quoted = false;
+    qsizetype boundary = -1;
+    for (qsizetype i = 0; i < data.size(); ++i) {
+        if (bytes[i] == '"') quoted = !quoted;
+        else if (bytes[i] == '\n' && !quoted) boundary = i + 1;
+    }
+    return boundary;
+}
+
+// Runs on the thread pool: turns one block of whole lines into validated records
+ParsedBlock parseBlock(const QByteArray& data, int firstLine, const ColumnMap& columns)
+{
+    ParsedBlock block;
+    block.bytes = data.size();
+    const QLocale c = QLocale::c();
+
+    forEachRecord(QString::fromUtf8(data), firstLine, [&](const QStringList& fields, int line) {
+        block.rows++;
+        auto reject = [&](const QString& reason) {
+            block.rejected++;
+            if (block.errors.size() < CatalogImporter::MaxErrors) block.errors.append(QString("Line %1: %2").arg(line).arg(reason));
+        };
+        if (fields.size() <= columns.lastIndex()) {
+            reject(QString("expected at least %1 fields, found %2").arg(columns.lastIndex() + 1).arg(fields.size()));
+            return;
+        }
+
+        MedicineRecord record;
+        record.name = fields.at(columns.name).trimmed();
+        record.batchNumber = fields.at(columns.batch).trimmed();
+        if (record.name.isEmpty() || record.batchNumber.isEmpty()) {
+            reject("name and batch are required");
+            return;
+        }
+
+        const QString expiry = fields.at(columns.expiry).trimmed();
+        if (!expiry.isEmpty()) {
+            record.expiry = QDate::fromString(expiry, "yyyy-MM-dd");
+            if (!record.expiry.isValid()) record.expiry = QDate::fromString(expiry, "dd/MM/yyyy");
+            if (!record.expiry.isValid()) {
+                reject(QString("bad expiry date \"%1\"").arg(expiry));
+                return;
+            }
+        }
+
+        bool ok = false;
+        record.quantity = fields.at(columns.quantity).trimmed().toInt(&ok);
+        if (!ok || record.quantity < 0) {
+            reject(QString("bad quantity \"%1\"").arg(fields.at(columns.quantity)));
+            return;
+        }
+        const double price = c.toDouble(fields.at(columns.price).trimmed(), &ok);
+        if (!ok || price < 0) {
+            reject(QString("bad price \"%1\"").arg(fields.at(columns.price)));
+            return;
+        }
+        record.priceCents = Money::toCents(price);
+        block.records.append(record);
+    });
+    return block;
+}
+
+}
+
+CatalogImporter::CatalogImporter(const QString& databasePath, QObject *parent)
+    : QObject(parent), m_databasePath(databasePath)
+{
+}
+
+CatalogImporter::~CatalogImporter()
+{
+    cancel();
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool CatalogImporter::start(const QString& csvPath)
+{
+    if (m_running) return false;
+    // The previous run has emitted finished() and is at most returning
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+    m_running = true;
+    m_cancelled = false;
+    m_thread = QThread::create([this, csvPath]() { run(csvPath); });
+    m_thread->setObjectName("CatalogImport");
+    m_thread->start();
+    return true;
+}
+
+void CatalogImporter::run(const QString& csvPath)
+{
+    CatalogImportProgress stats;
+    QStringList errors;
+    QElapsedTimer timer;
+    timer.start();
+    auto finish = [&](bool ok) {
+        stats.elapsedMs = timer.elapsed();
+        m_running = false;
+        emit finished(ok, stats, errors);
+    };
+
+    QFile file(csvPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errors.append(QString("Cannot open %1: %2").arg(csvPath, file.errorString()));
+        finish(false);
+        return;
+    }
+    stats.totalBytes = file.size();
+
+    QByteArray header = file.readLine();
+    stats.bytesRead = header.size();
+    if (header.startsWith("\xEF\xBB\xBF")) header.remove(0, 3);
+    ColumnMap columns;
+    forEachRecord(QString::fromUtf8(header), 1, [&columns](const QStringList& fields, int) { columns = mapColumns(fields); });
+    if (!columns.isValid()) {
+        errors.append("The first line must name the columns name, batch, expiry, quantity and price");
+        finish(false);
+        return;
+    }
+
+    // Connection names must be unique per process
+    static QAtomicInt instanceCounter;
+    const QString connectionName = QString("medicare-import-%1").arg(instanceCounter.fetchAndAddRelaxed(1));
+    bool ok = true;
+    {
+        DatabaseManager db(connectionName, m_databasePath);
+        ok = db.initDatabase();
+        if (!ok) errors.append("Failed to open the database");
+
+        QElapsedTimer sinceProgress;
+        sinceProgress.start();
+        auto writeBlock = [&](const ParsedBlock& block) {
+            stats.rowsRead += block.rows;
+            stats.rejected += block.rejected;
+            for (const QString& error : block.errors) {
+                if (errors.size() < MaxErrors) errors.append(error);
+            }
+            for (qsizetype i = 0; i < block.records.size(); i += BatchRows) {
+                const ImportBatchResult result = db.importMedicines(block.records.mid(i, BatchRows), m_duplicates);
+                if (!result.ok) {
+                    errors.append("Writing to the database failed; the import stopped there");
+                    return false;
+                }
+                stats.inserted += result.inserted;
+                stats.updated += result.updated;
+                stats.skipped += result.skipped;
+            }
+            stats.bytesRead += block.bytes;
+            if (sinceProgress.elapsed() >= ProgressIntervalMs) {
+                stats.elapsedMs = timer.elapsed();
+                emit progress(stats);
+                sinceProgress.restart();
+            }
+            return true;
+        };
+
+        // Enough blocks in flight to keep every pool thread parsing while one is written
+        const int maxInFlight = qMax(2, 2 * QThread::idealThreadCount());
+        QQueue<QFuture<ParsedBlock>> inFlight;
+        QByteArray carry;
+        int nextLine = 2;
+        while (ok && !file.atEnd()) {
+            if (m_cancelled) {
+                errors.append("Import cancelled");
+                ok = false;
+                break;
+            }
+            QByteArray data = carry + file.read(BlockBytes);
+            qsizetype cut = file.atEnd() ? data.size() : recordBoundary(data);
+            if (cut < 0) {
+                // No line ends in this block, e.g. a long quoted field; read on
+                carry = data;
+                continue;
+            }
+            carry = data.mid(cut);
+            data.truncate(cut);
+            const int firstLine = nextLine;
+            nextLine += data.count('\n');
+            inFlight.enqueue(QtConcurrent::run(parseBlock, data, firstLine, columns));
+            while (ok && inFlight.size() >= maxInFlight) ok = writeBlock(inFlight.dequeue().result());
+        }
+        while (!inFlight.isEmpty()) {
+            QFuture<ParsedBlock> next = inFlight.dequeue();
+            if (ok && m_cancelled) {
+                errors.append("Import cancelled");
+                ok = false;
+            }
+            if (ok) ok = writeBlock(next.result());
+            else next.waitForFinished();
+        }
+        if (ok && file.error() != QFileDevice::NoError) {
+            errors.append(QString("Reading %1 failed: %2").arg(csvPath, file.errorString()));
+            ok = false;
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    finish(ok);
+}
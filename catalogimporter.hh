@@ -0,0 +1,79 @@
+#ifndef CATALOGIMPORTER_H
+#define CATALOGIMPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include "databasemanager.h"
+
+class QThread;
+
+// Counters reported while a catalog import runs and once it ends
+struct CatalogImportProgress
+{
+    qint64 bytesRead = 0;    // of the file, up to the last block written
+    qint64 totalBytes = 0;
+    int rowsRead = 0;
+    int inserted = 0;
+    int updated = 0;
+    int skipped = 0;
+    int rejected = 0;        // lines that failed validation
+    qint64 elapsedMs = 0;
+
+    double rowsPerSecond() const { return elapsedMs > 0 ? rowsRead * 1000.0 / elapsedMs : 0.0; }
+};
+Q_DECLARE_METATYPE(CatalogImportProgress)
+
+// Streams a supplier catalog CSV into the Medicines table.
+//
+// The file is read in blocks on the importer's own thread. Each block is
+// parsed and validated on the global thread pool while the next ones are
+// read, and the records are written in file order, BatchRows per transaction,
+// through DatabaseManager::importMedicines() on a connection of the
+// importer's own, so the rest of the app keeps working meanwhile.
+//
+// The first line names the columns, in any order: name, batch (or
+// batchNumber), expiry (yyyy-MM-dd or dd/MM/yyyy, may be empty), quantity
+// and price. Other columns are ignored.
+class CatalogImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 BlockBytes = 1 << 20;
+    static constexpr int BatchRows = 5000;
+    static constexpr int MaxErrors = 100; // rejected lines described in finished()
+
+    // An empty databasePath opens the same file as the default DatabaseManager
+    explicit CatalogImporter(const QString& databasePath = QString(), QObject *parent = nullptr);
+    // Cancels a running import and waits for it
+    ~CatalogImporter();
+
+    void setDuplicatePolicy(DatabaseManager::DuplicateBatch duplicates) { m_duplicates = duplicates; }
+
+    // Starts importing csvPath in the background; false if an import is already running
+    bool start(const QString& csvPath);
+    // Stops after the block being written; batches already written stay committed
+    void cancel() { m_cancelled = true; }
+    bool isRunning() const { return m_running; }
+
+signals:
+    // Emitted from the import thread about every ProgressIntervalMs
+    void progress(const CatalogImportProgress& progress);
+    // ok is false if the file could not be read, a batch failed or the import was cancelled
+    void finished(bool ok, const CatalogImportProgress& summary, const QStringList& errors);
+
+private:
+    static constexpr int ProgressIntervalMs = 100;
+
+    void run(const QString& csvPath);
+
+    QString m_databasePath;
+    DatabaseManager::DuplicateBatch m_duplicates = DatabaseManager::UpdateDuplicates;
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancelled{false};
+};
+
+#endif // CATALOGIMPORTER_H
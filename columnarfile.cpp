@@ -0,0 +1,246 @@
+#include "columnarfile.h"
+#include <QSysInfo>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+const char Magic[4] = {'M', 'C', 'O', 'L'};
+constexpr int TrailerBytes = 8 + 8 + 4;
+
+template <typename T>
+void appendLittleEndian(QByteArray& bytes, T value)
+{
+    char buffer[sizeof(T)];
+    qToLittleEndian(value, buffer);
+    bytes.append(buffer, sizeof(T));
+}
+
+template <typename T>
+T readLittleEndian(const uchar *data)
+{
+    return qFromLittleEndian<T>(data);
+}
+}
+
+ColumnarWriter::ColumnarWriter(int rowGroupRows)
+    : m_rowGroupRows(qMax(1, rowGroupRows))
+{
+}
+
+bool ColumnarWriter::open(const QString& path, const QList<Columnar::Column>& columns)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly)) return false;
+
+    m_columns = columns;
+    m_rows = 0;
+    m_rowGroupCount = 0;
+    m_position = 0;
+    m_footer.clear();
+    m_ints = QVector<QVector<qint64>>(columns.size());
+    m_strings = QVector<QByteArray>(columns.size());
+    m_offsets = QVector<QVector<quint64>>(columns.size());
+    for (int i = 0; i < columns.size(); ++i) {
+        if (columns.at(i).type == Columnar::Int64) {
+            m_ints[i].reserve(m_rowGroupRows);
+        } else {
+            m_offsets[i].reserve(m_rowGroupRows + 1);
+            m_offsets[i].append(0);
+        }
+    }
+
+    QByteArray header(Magic, sizeof(Magic));
+    appendLittleEndian<quint32>(header, Columnar::Version);
+    appendLittleEndian<quint32>(header, columns.size());
+    for (const Columnar::Column& column : columns) {
+        const QByteArray name = column.name.toUtf8();
+        header.append(char(column.type));
+        header.append(char(0));
+        appendLittleEndian<quint16>(header, name.size());
+        header.append(name);
+    }
+    return write(header) && pad();
+}
+
+void ColumnarWriter::appendInt64(int column, qint64 value)
+{
+    m_ints[column].append(value);
+}
+
+void ColumnarWriter::appendString(int column, const QByteArray& utf8)
+{
+    m_strings[column].append(utf8);
+    m_offsets[column].append(m_strings.at(column).size());
+}
+
+bool ColumnarWriter::endRow()
+{
+    return ++m_rows < m_rowGroupRows || flushRowGroup();
+}
+
+bool ColumnarWriter::commit()
+{
+    if (m_rows > 0 && !flushRowGroup()) {
+        m_file.cancelWriting();
+        return false;
+    }
+    const quint64 footerOffset = m_position;
+    QByteArray trailer;
+    appendLittleEndian<quint64>(trailer, m_rowGroupCount);
+    appendLittleEndian<quint64>(trailer, footerOffset);
+    trailer.append(Magic, sizeof(Magic));
+    if (!write(m_footer) || !write(trailer)) {
+        m_file.cancelWriting();
+        return false;
+    }
+    return m_file.commit();
+}
+
+void ColumnarWriter::cancel()
+{
+    m_file.cancelWriting();
+    m_file.commit(); // discards the temporary file
+}
+
+bool ColumnarWriter::flushRowGroup()
+{
+    appendLittleEndian<quint64>(m_footer, m_rows);
+    for (int i = 0; i < m_columns.size(); ++i) {
+        const quint64 start = m_position;
+        if (m_columns.at(i).type == Columnar::Int64) {
+            QVector<qint64>& values = m_ints[i];
+            if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+                for (qint64& value : values) value = qToLittleEndian(value);
+            }
+            if (!write(QByteArray::fromRawData(reinterpret_cast<const char*>(values.constData()), values.size() * sizeof(qint64)))) {
+                return false;
+            }
+            values.clear();
+        } else {
+            QVector<quint64>& offsets = m_offsets[i];
+            if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+                for (quint64& offset : offsets) offset = qToLittleEndian(offset);
+            }
+            if (!write(QByteArray::fromRawData(reinterpret_cast<const char*>(offsets.constData()), offsets.size() * sizeof(quint64)))
+                || !write(m_strings.at(i))) {
+                return false;
+            }
+            offsets.clear();
+            offsets.append(0);
+            m_strings[i].clear();
+        }
+        appendLittleEndian<quint64>(m_footer, start);
+        appendLittleEndian<quint64>(m_footer, m_position - start);
+        if (!pad()) return false;
+    }
+    m_rows = 0;
+    m_rowGroupCount++;
+    return true;
+}
+
+bool ColumnarWriter::write(const QByteArray& bytes)
+{
+    if (m_file.write(bytes) != bytes.size()) return false;
+    m_position += bytes.size();
+    return true;
+}
+
+bool ColumnarWriter::pad()
+{
+    const int padding = (8 - m_position % 8) % 8;
+    return padding == 0 || write(QByteArray(padding, '\0'));
+}
+
+ColumnarReader::~ColumnarReader()
+{
+    if (m_data) m_file.unmap(const_cast<uchar*>(m_data));
+}
+
+bool ColumnarReader::open(const QString& path)
+{
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) return fail("Columnar files can only be mapped on little-endian hosts");
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) return fail(m_file.errorString());
+    m_size = m_file.size();
+    if (m_size < 12 + TrailerBytes) return fail("File is too short");
+    m_data = m_file.map(0, m_size);
+    if (!m_data) return fail(m_file.errorString());
+
+    const uchar *trailer = m_data + m_size - TrailerBytes;
+    if (std::memcmp(m_data, Magic, 4) != 0 || std::memcmp(trailer + 16, Magic, 4) != 0) return fail("Not a columnar file");
+    if (readLittleEndian<quint32>(m_data + 4) != Columnar::Version) return fail("Unsupported columnar file version");
+
+    const quint32 columnCount = readLittleEndian<quint32>(m_data + 8);
+    qint64 position = 12;
+    for (quint32 i = 0; i < columnCount; ++i) {
+        if (position + 4 > m_size) return fail("Truncated header");
+        const quint8 type = m_data[position];
+        const quint16 nameBytes = readLittleEndian<quint16>(m_data + position + 2);
+        position += 4;
+        if (position + nameBytes > m_size || (type != Columnar::Int64 && type != Columnar::Utf8)) return fail("Bad column header");
+        m_columns.append({QString::fromUtf8(reinterpret_cast<const char*>(m_data + position), nameBytes), Columnar::Type(type)});
+        position += nameBytes;
+    }
+
+    const quint64 groupCount = readLittleEndian<quint64>(trailer);
+    const quint64 footerOffset = readLittleEndian<quint64>(trailer + 8);
+    const quint64 footerBytes = groupCount * (8 + columnCount * 16);
+    if (footerOffset + footerBytes != quint64(m_size - TrailerBytes)) return fail("Bad footer");
+
+    const uchar *footer = m_data + footerOffset;
+    for (quint64 g = 0; g < groupCount; ++g) {
+        RowGroup group;
+        group.rows = readLittleEndian<quint64>(footer);
+        footer += 8;
+        for (quint32 c = 0; c < columnCount; ++c) {
+            const quint64 offset = readLittleEndian<quint64>(footer);
+            const quint64 bytes = readLittleEndian<quint64>(footer + 8);
+            footer += 16;
+            const quint64 expected = m_columns.at(c).type == Columnar::Int64 ? group.rows * 8 : (group.rows + 1) * 8;
+            if (offset % 8 != 0 || offset + bytes > footerOffset || bytes < expected) return fail("Bad row group");
+            group.offsets.append(offset);
+            group.bytes.append(bytes);
+        }
+        m_groups.append(group);
+    }
+    return true;
+}
+
+int ColumnarReader::columnIndex(const QString& name) const
+{
+    for (int i = 0; i < m_columns.size(); ++i) {
+        if (m_columns.at(i).name == name) return i;
+    }
+    return -1;
+}
+
+qint64 ColumnarReader::totalRows() const
+{
+    qint64 rows = 0;
+    for (const RowGroup& group : m_groups) rows += group.rows;
+    return rows;
+}
+
+const qint64* ColumnarReader::int64Column(int rowGroup, int column) const
+{
+    if (m_columns.at(column).type != Columnar::Int64) return nullptr;
+    return reinterpret_cast<const qint64*>(m_data + m_groups.at(rowGroup).offsets.at(column));
+}
+
+QByteArrayView ColumnarReader::string(int rowGroup, int column, qint64 row) const
+{
+    const RowGroup& group = m_groups.at(rowGroup);
+    if (m_columns.at(column).type != Columnar::Utf8 || row < 0 || row >= group.rows) return QByteArrayView();
+    const uchar *chunk = m_data + group.offsets.at(column);
+    const quint64 *offsets = reinterpret_cast<const quint64*>(chunk);
+    const quint64 bytesStart = (group.rows + 1) * 8;
+    const quint64 begin = offsets[row], end = offsets[row + 1];
+    if (begin > end || bytesStart + end > group.bytes.at(column)) return QByteArrayView();
+    return QByteArrayView(reinterpret_cast<const char*>(chunk + bytesStart + begin), qsizetype(end - begin));
+}
+
+bool ColumnarReader::fail(const QString& error)
+{
+    m_error = error;
+    return false;
+}
@@ -0,0 +1,122 @@
+#ifndef COLUMNARFILE_H
+#define COLUMNARFILE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QVector>
+#include <QFile>
+#include <QSaveFile>
+#include <limits>
+
+// Column-oriented archive format (".mcol") for reporting tools that mmap the
+// file and read whole columns without parsing. Everything is little-endian.
+//
+//   file      := header rowGroup* footer
+//   header    := "MCOL" u32 version u32 columnCount
+//                { u8 type, u8 0, u16 nameBytes, name (UTF-8) }*   padded to 8 bytes
+//   rowGroup  := one chunk per column, each starting 8-byte aligned
+//                Int64: rowCount x i64 (NullInt64 marks a missing value)
+//                Utf8:  (rowCount + 1) x u64 offsets into the bytes that follow, then the bytes
+//   footer    := per row group: u64 rowCount, columnCount x (u64 chunkOffset, u64 chunkBytes)
+//                u64 rowGroupCount, u64 footerOffset, "MCOL"
+//
+// Rows are buffered one row group at a time, so writing needs memory for a
+// single group however many rows the file ends up with.
+namespace Columnar {
+
+enum Type : quint8 {
+    Int64 = 1,
+    Utf8 = 2
+};
+
+struct Column
+{
+    QString name;
+    Type type;
+};
+
+constexpr quint32 Version = 1;
+constexpr qint64 NullInt64 = std::numeric_limits<qint64>::min();
+
+}
+
+class ColumnarWriter
+{
+public:
+    static constexpr int DefaultRowGroupRows = 65536;
+
+    explicit ColumnarWriter(int rowGroupRows = DefaultRowGroupRows);
+
+    // Writes to a temporary file that replaces path only on commit()
+    bool open(const QString& path, const QList<Columnar::Column>& columns);
+
+    // Set every column of a row, then endRow()
+    void appendInt64(int column, qint64 value);
+    void appendString(int column, const QByteArray& utf8);
+    // Writes the row group out once it is full; false on a write error
+    bool endRow();
+
+    bool commit();
+    void cancel();
+    QString errorString() const { return m_file.errorString(); }
+
+private:
+    bool flushRowGroup();
+    bool write(const QByteArray& bytes);
+    bool pad();
+
+    QSaveFile m_file;
+    QList<Columnar::Column> m_columns;
+    int m_rowGroupRows;
+    int m_rows = 0;                        // in the current row group
+    QVector<QVector<qint64>> m_ints;       // per Int64 column
+    QVector<QByteArray> m_strings;         // per Utf8 column
+    QVector<QVector<quint64>> m_offsets;   // per Utf8 column
+    QByteArray m_footer;
+    quint64 m_rowGroupCount = 0;
+    quint64 m_position = 0;
+};
+
+// Maps a .mcol file and hands out pointers straight into it
+class ColumnarReader
+{
+public:
+    ColumnarReader() = default;
+    ~ColumnarReader();
+    ColumnarReader(const ColumnarReader&) = delete;
+    ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+    bool open(const QString& path);
+    QString errorString() const { return m_error; }
+
+    const QList<Columnar::Column>& columns() const { return m_columns; }
+    int columnIndex(const QString& name) const;
+    int rowGroupCount() const { return m_groups.size(); }
+    qint64 rowCount(int rowGroup) const { return m_groups.at(rowGroup).rows; }
+    qint64 totalRows() const;
+
+    // rowCount(rowGroup) values of an Int64 column
+    const qint64* int64Column(int rowGroup, int column) const;
+    QByteArrayView string(int rowGroup, int column, qint64 row) const;
+
+private:
+    struct RowGroup
+    {
+        qint64 rows = 0;
+        QVector<quint64> offsets;  // per column, from the start of the file
+        QVector<quint64> bytes;
+    };
+
+    bool fail(const QString& error);
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    QList<Columnar::Column> m_columns;
+    QVector<RowGroup> m_groups;
+    QString m_error;
+};
+
+#endif // COLUMNARFILE_H
@@ -0,0 +1,207 @@
+#include "copilotcache.h"
+#include "medicineretrieval.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+constexpr int FileVersion = 1;
+
+qint64 entryBytes(const QString& key, const QStringList& suggestions)
+{
+    qint64 bytes = key.size();
+    for (const QString& suggestion : suggestions) bytes += suggestion.size() + 1;
+    return bytes;
+}
+
+}
+
+CopilotCache::CopilotCache(const QString& path, qint64 ttlSeconds, QObject *parent)
+    : QObject(parent), m_path(path), m_ttlSeconds(ttlSeconds), m_saveTimer(new QTimer(this))
+{
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SaveDelayMs);
+    connect(m_saveTimer, &QTimer::timeout, this, &CopilotCache::save);
+    load();
+}
+
+CopilotCache::~CopilotCache()
+{
+    save();
+}
+
+QString CopilotCache::normalizeSymptoms(const QString& symptoms)
+{
+    static const QRegularExpression separators("[^\\w]+");
+
+    QStringList words;
+    const QStringList tokens = symptoms.normalized(QString::NormalizationForm_KC).toCaseFolded().split(separators, Qt::SkipEmptyParts);
+    for (const QString& token : tokens) {
+        if (!MedicineRetrieval::isStopWord(token)) words.append(token);
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words.join(' ');
+}
+
+QByteArray CopilotCache::stockHash(QStringList inStockNames)
+{
+    std::sort(inStockNames.begin(), inStockNames.end());
+    inStockNames.erase(std::unique(inStockNames.begin(), inStockNames.end()), inStockNames.end());
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (const QString& name : std::as_const(inStockNames)) {
+        hash.addData(name.toUtf8());
+        hash.addData(QByteArrayView("\n"));
+    }
+    return hash.result().toHex();
+}
+
+QString CopilotCache::key(const QString& normalizedSymptoms, const QByteArray& stockHash)
+{
+    return normalizedSymptoms + QLatin1Char('\n') + QString::fromLatin1(stockHash);
+}
+
+bool CopilotCache::find(const QString& symptoms, const QByteArray& stockHash, QStringList *suggestions)
+{
+    auto it = m_entries.find(key(normalizeSymptoms(symptoms), stockHash));
+    if (it == m_entries.end()) return false;
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    if (now - it->createdAt > m_ttlSeconds) {
+        m_bytes -= it->bytes;
+        m_entries.erase(it);
+        scheduleSave();
+        return false;
+    }
+    it->lastUsed = now;
+    *suggestions = it->suggestions;
+    scheduleSave();
+    return true;
+}
+
+void CopilotCache::insert(const QString& symptoms, const QByteArray& stockHash, const QStringList& suggestions)
+{
+    const QString entryKey = key(normalizeSymptoms(symptoms), stockHash);
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    Entry entry;
+    entry.suggestions = suggestions;
+    entry.createdAt = now;
+    entry.lastUsed = now;
+    entry.bytes = entryBytes(entryKey, suggestions);
+
+    auto existing = m_entries.constFind(entryKey);
+    if (existing != m_entries.constEnd()) m_bytes -= existing->bytes;
+    m_entries.insert(entryKey, entry);
+    m_bytes += entry.bytes;
+    evict();
+    scheduleSave();
+}
+
+void CopilotCache::clear()
+{
+    m_entries.clear();
+    m_bytes = 0;
+    scheduleSave();
+}
+
+void CopilotCache::evict()
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (now - it->createdAt > m_ttlSeconds) {
+            m_bytes -= it->bytes;
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // A linear scan per eviction is fine at a few hundred entries
+    while (m_entries.size() > MaxEntries || (m_bytes > MaxBytes && m_entries.size() > 1)) {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) oldest = it;
+        }
+        m_bytes -= oldest->bytes;
+        m_entries.erase(oldest);
+    }
+}
+
+void CopilotCache::scheduleSave()
+{
+    m_dirty = true;
+    m_saveTimer->start();
+}
+
+void CopilotCache::load()
+{
+    QFile file(m_path);
+    if (!file.exists()) return;
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Cannot read the Copilot cache" << m_path << file.errorString();
+        return;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != FileVersion) {
+        qDebug() << "Ignoring the Copilot cache" << m_path << "(unknown version)";
+        return;
+    }
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const QJsonArray entries = root.value("entries").toArray();
+    for (const QJsonValue& value : entries) {
+        const QJsonObject object = value.toObject();
+        Entry entry;
+        entry.createdAt = object.value("created").toInteger();
+        if (now - entry.createdAt > m_ttlSeconds) continue;
+        entry.lastUsed = object.value("used").toInteger();
+        for (const QJsonValue& suggestion : object.value("suggestions").toArray()) entry.suggestions.append(suggestion.toString());
+        const QString entryKey = key(object.value("symptoms").toString(), object.value("stock").toString().toLatin1());
+        entry.bytes = entryBytes(entryKey, entry.suggestions);
+        m_entries.insert(entryKey, entry);
+        m_bytes += entry.bytes;
+    }
+    evict();
+}
+
+bool CopilotCache::save()
+{
+    m_saveTimer->stop();
+    if (!m_dirty) return true;
+
+    QJsonArray entries;
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        const qsizetype split = it.key().lastIndexOf(QLatin1Char('\n'));
+        entries.append(QJsonObject{
+            {"symptoms", it.key().left(split)},
+            {"stock", it.key().mid(split + 1)},
+            {"created", it->createdAt},
+            {"used", it->lastUsed},
+            {"suggestions", QJsonArray::fromStringList(it->suggestions)},
+        });
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write the Copilot cache" << m_path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{"version", FileVersion}, {"entries", entries}}).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qDebug() << "Cannot write the Copilot cache" << m_path << file.errorString();
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
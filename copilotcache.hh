@@ -0,0 +1,72 @@
+#ifndef COPILOTCACHE_H
+#define COPILOTCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+class QTimer;
+
+// PharmaCopilot answers kept on disk, so a repeated question is answered
+// without a network round trip.
+//
+// An entry is keyed by the normalized symptoms and a hash of the in-stock
+// medicine names the prompt listed. Any change to which medicines are in
+// stock changes the hash, so answers given for other stock are never served.
+// Entries expire after the TTL, and the least recently used ones are dropped
+// beyond MaxEntries or MaxBytes. The file is rewritten shortly after a change
+// and on destruction.
+class CopilotCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MaxEntries = 500;
+    static constexpr qint64 MaxBytes = 1 << 20;          // suggestion text, roughly
+    static constexpr qint64 DefaultTtlSeconds = 7 * 24 * 3600;
+    static constexpr int SaveDelayMs = 2000;
+
+    // Loads path if it exists; entries already expired are skipped
+    explicit CopilotCache(const QString& path, qint64 ttlSeconds = DefaultTtlSeconds, QObject *parent = nullptr);
+    ~CopilotCache();
+
+    // Lower-case words, without punctuation and filler words, sorted: "Cough and
+    // cold" and "cold, cough" are the same question
+    static QString normalizeSymptoms(const QString& symptoms);
+    // Order-independent hash of the medicine names offered to the model
+    static QByteArray stockHash(QStringList inStockNames);
+
+    // True and the cached suggestions (empty for "none suitable") on a hit
+    bool find(const QString& symptoms, const QByteArray& stockHash, QStringList *suggestions);
+    void insert(const QString& symptoms, const QByteArray& stockHash, const QStringList& suggestions);
+    void clear();
+
+    int size() const { return m_entries.size(); }
+    // Writes the file now if anything changed; false if it could not be written
+    bool save();
+
+private:
+    struct Entry
+    {
+        QStringList suggestions;
+        qint64 createdAt = 0;   // seconds since the epoch
+        qint64 lastUsed = 0;
+        qint64 bytes = 0;
+    };
+
+    static QString key(const QString& normalizedSymptoms, const QByteArray& stockHash);
+    void load();
+    void evict();
+    void scheduleSave();
+
+    QString m_path;
+    qint64 m_ttlSeconds;
+    QHash<QString, Entry> m_entries;   // normalized symptoms + '\n' + stock hash
+    qint64 m_bytes = 0;
+    bool m_dirty = false;
+    QTimer *m_saveTimer;
+};
+
+#endif // COPILOTCACHE_H
@@ -1,8 +1,46 @@
 #include "databasemanager.h"
+#include "stockstore.h"
+#include "schemamigrations.h"
+#include "metrics.h"
+#include "money.h"
+#include "tracing.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
 #include <QDir>
+#include <QHash>
+#include <QSet>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QSysInfo>
+#include <utility>
+
+namespace {
+// Units of a medicine held by terminals other than the one bound to the
+// correlated terminalId parameter; expired holds do not count
+const char OtherHoldsSql[] =
+    "(SELECT COALESCE(SUM(h.quantity), 0) FROM StockHolds h "
+    " WHERE h.medicineId = Medicines.id AND h.terminalId <> ? AND h.expiresAt > ?)";
+
+// Expiry is stored as a Julian day number, NULL when no valid date was given
+QVariant expiryDayValue(const QString& expiryDate)
+{
+    const QDate date = QDate::fromString(expiryDate, "yyyy-MM-dd");
+    return date.isValid() ? QVariant(date.toJulianDay()) : QVariant();
+}
+
+qint64 expiryDayFromColumn(const QVariant& value)
+{
+    return value.isNull() ? QDate().toJulianDay() : value.toLongLong();
+}
+
+QString expiryTextFromColumn(const QVariant& value)
+{
+    return value.isNull() ? QString() : QDate::fromJulianDay(value.toLongLong()).toString("yyyy-MM-dd");
+}
+}
 
 // Define the static constant for the database path
 const QString DatabaseManager::DB_PATH = "database/medicare.db";
@@ -11,10 +49,24 @@ const QString DatabaseManager::DB_PATH = "database/medicare.db";
 
 #include <QFileInfo> // <-- Add this include at the top
 
-DatabaseManager::DatabaseManager()
+DatabaseManager::DatabaseManager(QObject *parent)
+    : DatabaseManager(QString(), QString(), parent)
+{
+}
+
+DatabaseManager::DatabaseManager(const QString& connectionName, const QString& databasePath, QObject *parent)
+    : QObject(parent), m_profile(DatabaseProfile::fromEnvironment()), m_terminalId(defaultTerminalId())
 {
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
+    m_db = connectionName.isEmpty() ? QSqlDatabase::addDatabase("QSQLITE")
+                                    : QSqlDatabase::addDatabase("QSQLITE", connectionName);
 
+    QFileInfo info(databasePath.isEmpty() ? defaultDatabasePath() : databasePath);
+    QDir().mkpath(info.absolutePath());
+    m_db.setDatabaseName(info.absoluteFilePath());
+}
+
+QString DatabaseManager::defaultDatabasePath()
+{
     // Let's debug the pathing very carefully
     QString dbFolderPath = "database";
     QString dbFileName = "medicare.db";
@@ -33,13 +85,54 @@ DatabaseManager::DatabaseManager()
         qDebug() << "Database directory already exists at:" << dir.absolutePath();
     }
 
-    // Now, set the full, absolute path for the database name
-    m_db.setDatabaseName(dir.absoluteFilePath(dbFileName));
+    // Now, return the full, absolute path for the database name
+    const QString path = dir.absoluteFilePath(dbFileName);
+    qDebug() << "Final absolute database path is:" << path;
+    return path;
+}
 
-    qDebug() << "Final absolute database path is:" << m_db.databaseName();
+DatabaseManager::~DatabaseManager()
+{
+    m_statements.clear();
+    m_failedStatement.clear();
 }
+
+QString DatabaseManager::defaultTerminalId()
+{
+    const QString configured = qEnvironmentVariable("MEDICARE_TERMINAL_ID");
+    if (!configured.isEmpty()) return configured;
+    return QString("%1-%2").arg(QSysInfo::machineHostName()).arg(QCoreApplication::applicationPid());
+}
+
+bool DatabaseManager::beginImmediate()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("BEGIN IMMEDIATE")) {
+        qDebug() << "Failed to start transaction:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QSqlQuery& DatabaseManager::cachedQuery(const QString& sql)
+{
+    auto it = m_statements.find(sql);
+    if (it != m_statements.end()) return it->second;
+
+    QSqlQuery query(m_db);
+    if (!query.prepare(sql)) {
+        // Not cached, so the next call tries again; exec() on it fails
+        qDebug() << "Failed to prepare statement:" << sql << query.lastError().text();
+        m_failedStatement = std::move(query);
+        return m_failedStatement;
+    }
+    return m_statements.emplace(sql, std::move(query)).first->second;
+}
+
 bool DatabaseManager::initDatabase()
 {
+    TRACE_SCOPE("db", "DatabaseManager::initDatabase");
+    LATENCY_SCOPE("db.initDatabase");
     if (!m_db.open()) {
         qDebug() << "Error: connection with database failed:" << m_db.lastError().text();
         return false;
@@ -47,79 +140,259 @@ bool DatabaseManager::initDatabase()
 
     qDebug() << "Database: connection ok";
 
-    QSqlQuery query;
-
-    // Create Medicines Table
-    bool success = query.exec("CREATE TABLE IF NOT EXISTS Medicines ("
-                              "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                              "name TEXT NOT NULL, "
-                              "batchNumber TEXT, "
-                              "expiryDate TEXT, "
-                              "quantity INTEGER, "
-                              "price REAL"
-                              ");");
-    if(!success) {
-        qDebug() << "Failed to create Medicines table:" << query.lastError().text();
+    if (!applyProfile()) {
         return false;
     }
 
-    // Create Invoices Table
-    success = query.exec("CREATE TABLE IF NOT EXISTS Invoices ("
-                         "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                         "saleDate TEXT, "
-                         "totalAmount REAL"
-                         ");");
-    if(!success) {
-        qDebug() << "Failed to create Invoices table:" << query.lastError().text();
-        return false;
+    return migrate();
+}
+
+int DatabaseManager::schemaVersion()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        qDebug() << "Failed to read schema version:" << query.lastError().text();
+        return -1;
     }
+    return query.value(0).toInt();
+}
 
-    // Create InvoiceItems Table
-    success = query.exec("CREATE TABLE IF NOT EXISTS InvoiceItems ("
-                         "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                         "invoiceId INTEGER, "
-                         "medicineId INTEGER, "
-                         "quantitySold INTEGER, "
-                         "priceAtSale REAL, "
-                         "FOREIGN KEY(invoiceId) REFERENCES Invoices(id), "
-                         "FOREIGN KEY(medicineId) REFERENCES Medicines(id)"
-                         ");");
-    if(!success) {
-        qDebug() << "Failed to create InvoiceItems table:" << query.lastError().text();
-        return false;
+bool DatabaseManager::migrate()
+{
+    TRACE_SCOPE("db", "DatabaseManager::migrate");
+    LATENCY_SCOPE("db.migrate");
+    for (const SchemaMigration& migration : SchemaMigration::all()) {
+        // The version is re-read under the write lock, so when several terminals
+        // start at once only the first one runs each step
+        if (!beginImmediate()) return false;
+        const int current = schemaVersion();
+        if (current < 0) {
+            m_db.rollback();
+            return false;
+        }
+        if (current > SchemaMigration::latestVersion()) {
+            qDebug() << "Database schema version" << current << "is newer than this build supports ("
+                     << SchemaMigration::latestVersion() << ")";
+            m_db.rollback();
+            return false;
+        }
+        if (current >= migration.version) {
+            m_db.rollback();
+            continue;
+        }
+
+        QSqlQuery query(m_db);
+        for (const QString& statement : migration.statements) {
+            if (!query.exec(statement)) {
+                qDebug() << "Migration" << migration.version << "failed:" << query.lastError().text();
+                m_db.rollback();
+                return false;
+            }
+        }
+        // user_version lives in the file header and commits with the rest of the step
+        if (!query.exec(QString("PRAGMA user_version = %1").arg(migration.version)) || !m_db.commit()) {
+            qDebug() << "Failed to record migration" << migration.version << ":" << m_db.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+        qDebug() << "Applied schema migration" << migration.version << "-" << migration.description;
     }
 
-    qDebug() << "All tables created or already exist.";
+    qDebug() << "Database schema is at version" << SchemaMigration::latestVersion();
+    return true;
+}
+
+bool DatabaseManager::applyProfile()
+{
+    QSqlQuery query(m_db);
+    for (const QString& pragma : m_profile.pragmas()) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Failed to apply" << pragma << ":" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // journal_mode reports the mode actually in effect (e.g. WAL is refused on some network drives)
+    if (query.exec("PRAGMA journal_mode") && query.next()
+        && query.value(0).toString().compare(m_profile.journalMode, Qt::CaseInsensitive) != 0) {
+        qDebug() << "Requested journal mode" << m_profile.journalMode << "but SQLite is using" << query.value(0).toString();
+    }
+    qDebug() << "Database profile applied:" << m_profile.name;
     return true;
 }
 
 bool DatabaseManager::addMedicine(const QString& name, const QString& batchNumber, const QString& expiryDate, int quantity, double price)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO Medicines (name, batchNumber, expiryDate, quantity, price) "
-                  "VALUES (:name, :batchNumber, :expiryDate, :quantity, :price)");
-    query.bindValue(":name", name);
-    query.bindValue(":batchNumber", batchNumber);
-    query.bindValue(":expiryDate", expiryDate);
-    query.bindValue(":quantity", quantity);
-    query.bindValue(":price", price);
+    TRACE_SCOPE("db", "DatabaseManager::addMedicine");
+    LATENCY_SCOPE("db.addMedicine");
+    QSqlQuery& query = cachedQuery("INSERT INTO Medicines (name, batchNumber, expiryDay, quantity, priceCents) "
+                                   "VALUES (?, ?, ?, ?, ?)");
+    query.bindValue(0, name);
+    query.bindValue(1, batchNumber);
+    query.bindValue(2, expiryDayValue(expiryDate));
+    query.bindValue(3, quantity);
+    query.bindValue(4, Money::toCents(price));
 
     if (query.exec()) {
-        qDebug() << "Successfully added medicine:" << name;
+        MedicineChangeSet changes;
+        changes.inserted.append(query.lastInsertId().toInt());
+        emit medicinesChanged(changes);
         return true;
     } else {
         qDebug() << "Failed to add medicine:" << query.lastError().text();
         return false;
     }
 }
+ImportBatchResult DatabaseManager::importMedicines(const QList<MedicineRecord>& records, DuplicateBatch duplicates)
+{
+    TRACE_SCOPE("db", "DatabaseManager::importMedicines");
+    LATENCY_SCOPE("db.importMedicines");
+    ImportBatchResult result;
+    if (!beginImmediate()) return result;
+
+    QSqlQuery& findQuery = cachedQuery("SELECT id FROM Medicines WHERE batchNumber = ? LIMIT 1");
+    QSqlQuery& insertQuery = cachedQuery("INSERT INTO Medicines (name, batchNumber, expiryDay, quantity, priceCents) "
+                                         "VALUES (?, ?, ?, ?, ?)");
+    // On-hand stock is counted by sales and receipts, not by the catalogue,
+    // so a duplicate batch keeps its quantity
+    QSqlQuery& updateQuery = cachedQuery("UPDATE Medicines SET name = ?, expiryDay = ?, priceCents = ? WHERE id = ?");
+    for (const MedicineRecord& record : records) {
+        const QVariant expiryDay = record.expiry.isValid() ? QVariant(record.expiry.toJulianDay()) : QVariant();
+
+        findQuery.bindValue(0, record.batchNumber);
+        if (!findQuery.exec()) {
+            qDebug() << "Failed to look up batch" << record.batchNumber << ":" << findQuery.lastError().text();
+            m_db.rollback();
+            return ImportBatchResult();
+        }
+        const qint64 existingId = findQuery.next() ? findQuery.value(0).toLongLong() : 0;
+        findQuery.finish();
+
+        if (existingId > 0 && duplicates == SkipDuplicates) {
+            result.skipped++;
+            continue;
+        }
+        QSqlQuery& query = existingId > 0 ? updateQuery : insertQuery;
+        if (existingId > 0) {
+            query.bindValue(0, record.name);
+            query.bindValue(1, expiryDay);
+            query.bindValue(2, record.priceCents);
+            query.bindValue(3, existingId);
+        } else {
+            query.bindValue(0, record.name);
+            query.bindValue(1, record.batchNumber);
+            query.bindValue(2, expiryDay);
+            query.bindValue(3, record.quantity);
+            query.bindValue(4, record.priceCents);
+        }
+        if (!query.exec()) {
+            qDebug() << "Failed to import batch" << record.batchNumber << ":" << query.lastError().text();
+            m_db.rollback();
+            return ImportBatchResult();
+        }
+        if (existingId > 0) result.updated++; else result.inserted++;
+    }
+
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit import batch:" << m_db.lastError().text();
+        m_db.rollback();
+        return ImportBatchResult();
+    }
+    result.ok = true;
+    return result;
+}
+
+GoodsReceiptResult DatabaseManager::receiveGoods(const QList<ReceiptLine>& lines)
+{
+    TRACE_SCOPE("db", "DatabaseManager::receiveGoods");
+    LATENCY_SCOPE("db.receiveGoods");
+    GoodsReceiptResult result;
+    if (!beginImmediate()) return result;
 
+    QSqlQuery& idQuery = cachedQuery("SELECT id FROM Medicines WHERE id = ?");
+    QSqlQuery& batchQuery = cachedQuery("SELECT id FROM Medicines WHERE batchNumber = ? LIMIT 1");
+    QSqlQuery& addQuery = cachedQuery("UPDATE Medicines SET quantity = quantity + ? WHERE id = ?");
+    QSqlQuery& insertQuery = cachedQuery("INSERT INTO Medicines (name, batchNumber, expiryDay, quantity, priceCents) "
+                                         "VALUES (?, ?, ?, ?, ?)");
+    MedicineChangeSet changes;
+    QSet<qint64> touchedIds;
+    for (int i = 0; i < lines.size(); ++i) {
+        const ReceiptLine& line = lines.at(i);
+        // Without an ID the batch number is the only key; '' would match any unbatched medicine
+        if (line.quantity <= 0 || (line.medicineId <= 0 && line.batchNumber.trimmed().isEmpty())) {
+            result.rejectedLines.append(i);
+            continue;
+        }
+
+        // A batch created by an earlier line of the same delivery is found here too
+        QSqlQuery& findQuery = line.medicineId > 0 ? idQuery : batchQuery;
+        findQuery.bindValue(0, line.medicineId > 0 ? QVariant(line.medicineId) : QVariant(line.batchNumber));
+        if (!findQuery.exec()) {
+            qDebug() << "Failed to look up receipt line" << i << ":" << findQuery.lastError().text();
+            m_db.rollback();
+            return GoodsReceiptResult();
+        }
+        const qint64 id = findQuery.next() ? findQuery.value(0).toLongLong() : 0;
+        findQuery.finish();
+
+        if (id > 0) {
+            addQuery.bindValue(0, line.quantity);
+            addQuery.bindValue(1, id);
+            if (!addQuery.exec()) {
+                qDebug() << "Failed to add received stock:" << addQuery.lastError().text();
+                m_db.rollback();
+                return GoodsReceiptResult();
+            }
+            if (!touchedIds.contains(id)) {
+                touchedIds.insert(id);
+                changes.updated.append(int(id));
+            }
+        } else if (line.medicineId <= 0 && !line.batchNumber.isEmpty() && !line.name.trimmed().isEmpty()
+                   && line.expiry.isValid() && line.priceCents > 0) {
+            insertQuery.bindValue(0, line.name.trimmed());
+            insertQuery.bindValue(1, line.batchNumber);
+            insertQuery.bindValue(2, line.expiry.toJulianDay());
+            insertQuery.bindValue(3, line.quantity);
+            insertQuery.bindValue(4, line.priceCents);
+            if (!insertQuery.exec()) {
+                qDebug() << "Failed to add received batch:" << insertQuery.lastError().text();
+                m_db.rollback();
+                return GoodsReceiptResult();
+            }
+            const qint64 newId = insertQuery.lastInsertId().toLongLong();
+            touchedIds.insert(newId);
+            changes.inserted.append(int(newId));
+        } else {
+            result.rejectedLines.append(i);
+        }
+    }
+
+    if (!result.rejectedLines.isEmpty()) {
+        qDebug() << "Goods receipt refused;" << result.rejectedLines.size() << "lines could not be applied";
+        m_db.rollback();
+        return result;
+    }
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit goods receipt:" << m_db.lastError().text();
+        m_db.rollback();
+        return GoodsReceiptResult();
+    }
+
+    result.ok = true;
+    result.updated = changes.updated.size();
+    result.created = changes.inserted.size();
+    if (!changes.isEmpty()) emit medicinesChanged(changes);
+    return result;
+}
 
 QList<QVariantList> DatabaseManager::getAllMedicines()
 {
+    TRACE_SCOPE("db", "DatabaseManager::getAllMedicines");
+    LATENCY_SCOPE("db.getAllMedicines");
     QList<QVariantList> medicines;
-    QSqlQuery query("SELECT id, name, batchNumber, expiryDate, quantity, price FROM Medicines");
+    QSqlQuery query(m_db);
 
-    if (!query.exec()) {
+    if (!query.exec("SELECT id, name, batchNumber, expiryDay, quantity, priceCents FROM Medicines")) {
         qDebug() << "Failed to fetch medicines:" << query.lastError().text();
         return medicines; // Return empty list on failure
     }
@@ -129,45 +402,253 @@ QList<QVariantList> DatabaseManager::getAllMedicines()
         row << query.value(0); // ID
         row << query.value(1); // Name
         row << query.value(2); // Batch Number
-        row << query.value(3); // Expiry Date
+        row << expiryTextFromColumn(query.value(3)); // Expiry Date
         row << query.value(4); // Quantity
-        row << query.value(5); // Price
+        row << Money::fromCents(query.value(5).toLongLong()); // Price
         medicines.append(row);
     }
 
     return medicines;
 }
 
+bool DatabaseManager::loadMedicines(StockStore& store)
+{
+    TRACE_SCOPE("db", "DatabaseManager::loadMedicines");
+    LATENCY_SCOPE("db.loadMedicines");
+    store.clear();
+
+    QSqlQuery countQuery(m_db);
+    if (countQuery.exec("SELECT COUNT(*) FROM Medicines") && countQuery.next()) {
+        store.reserve(countQuery.value(0).toInt());
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true); // No need to cache rows we only walk once
+    if (!query.exec("SELECT id, name, batchNumber, expiryDay, quantity, priceCents FROM Medicines ORDER BY id")) {
+        qDebug() << "Failed to load medicines:" << query.lastError().text();
+        return false;
+    }
+
+    while (query.next()) {
+        store.append(query.value(0).toInt(), query.value(1).toString(), query.value(2).toString(),
+                     expiryDayFromColumn(query.value(3)), query.value(4).toInt(), query.value(5).toLongLong());
+    }
+    return true;
+}
+
+bool DatabaseManager::loadMedicines(StockStore& store, const QList<int>& ids)
+{
+    TRACE_SCOPE("db", "DatabaseManager::loadMedicines(ids)");
+    LATENCY_SCOPE("db.loadMedicines.ids");
+    // Change sets are small, so one cached single-row lookup per ID beats
+    // compiling a fresh IN (...) list for every distinct size
+    QSqlQuery& query = cachedQuery("SELECT id, name, batchNumber, expiryDay, quantity, priceCents "
+                                   "FROM Medicines WHERE id = ?");
+    for (int id : ids) {
+        query.bindValue(0, id);
+        if (!query.exec()) {
+            qDebug() << "Failed to reload medicine ID" << id << ":" << query.lastError().text();
+            return false;
+        }
+        if (query.next()) {
+            store.upsert(query.value(0).toInt(), query.value(1).toString(), query.value(2).toString(),
+                         expiryDayFromColumn(query.value(3)), query.value(4).toInt(), query.value(5).toLongLong());
+        }
+        query.finish();
+    }
+    return true;
+}
+
 
 bool DatabaseManager::updateMedicineQuantity(int medicineId, int quantityToSubtract)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE Medicines SET quantity = quantity - :quantityToSubtract WHERE id = :id");
-    query.bindValue(":quantityToSubtract", quantityToSubtract);
-    query.bindValue(":id", medicineId);
+    TRACE_SCOPE("db", "DatabaseManager::updateMedicineQuantity");
+    LATENCY_SCOPE("db.updateMedicineQuantity");
+    if (!subtractQuantity(medicineId, quantityToSubtract)) return false;
+    MedicineChangeSet changes;
+    changes.updated.append(medicineId);
+    emit medicinesChanged(changes);
+    return true;
+}
 
-    if (query.exec()) {
-        return true;
-    } else {
+bool DatabaseManager::subtractQuantity(int medicineId, int quantityToSubtract)
+{
+    TRACE_SCOPE("db", "DatabaseManager::subtractQuantity");
+    LATENCY_SCOPE("db.subtractQuantity");
+    // The guard makes the availability check and the decrement a single statement
+    QSqlQuery& query = cachedQuery(QString("UPDATE Medicines SET quantity = quantity - ? "
+                                           "WHERE id = ? AND quantity - %1 >= ?").arg(OtherHoldsSql));
+    query.bindValue(0, quantityToSubtract);
+    query.bindValue(1, medicineId);
+    query.bindValue(2, m_terminalId);
+    query.bindValue(3, QDateTime::currentSecsSinceEpoch());
+    query.bindValue(4, quantityToSubtract);
+
+    if (!query.exec()) {
         qDebug() << "Failed to update quantity for medicine ID" << medicineId << ":" << query.lastError().text();
         return false;
     }
+    if (query.numRowsAffected() != 1) {
+        qDebug() << "Insufficient unreserved stock for medicine ID" << medicineId;
+        return false;
+    }
+    return true;
 }
 
-qint64 DatabaseManager::createInvoice(double totalAmount, const QList<QPair<int, int>>& cartItems)
+StockHold DatabaseManager::holdStock(int medicineId, int quantity)
 {
+    TRACE_SCOPE("db", "DatabaseManager::holdStock");
+    LATENCY_SCOPE("db.holdStock");
+    StockHold hold;
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    if (!beginImmediate()) return hold;
+
+    QSqlQuery& purgeQuery = cachedQuery("DELETE FROM StockHolds WHERE expiresAt <= ?");
+    purgeQuery.bindValue(0, now);
+    if (!purgeQuery.exec()) {
+        qDebug() << "Failed to purge expired holds:" << purgeQuery.lastError().text();
+        m_db.rollback();
+        return hold;
+    }
+
+    QSqlQuery& availableQuery = cachedQuery(QString("SELECT quantity - %1 FROM Medicines WHERE id = ?").arg(OtherHoldsSql));
+    availableQuery.bindValue(0, m_terminalId);
+    availableQuery.bindValue(1, now);
+    availableQuery.bindValue(2, medicineId);
+    if (!availableQuery.exec()) {
+        qDebug() << "Failed to read available stock:" << availableQuery.lastError().text();
+        m_db.rollback();
+        return hold;
+    }
+    if (!availableQuery.next()) {
+        availableQuery.finish();
+        m_db.rollback();
+        hold.status = StockHold::NotFound;
+        return hold;
+    }
+    hold.available = qMax(0, availableQuery.value(0).toInt());
+    availableQuery.finish();
+
+    if (quantity > hold.available) {
+        m_db.rollback();
+        hold.status = StockHold::Insufficient;
+        return hold;
+    }
+
+    QSqlQuery& holdQuery = quantity > 0
+        ? cachedQuery("INSERT OR REPLACE INTO StockHolds (medicineId, terminalId, quantity, expiresAt) VALUES (?, ?, ?, ?)")
+        : cachedQuery("DELETE FROM StockHolds WHERE medicineId = ? AND terminalId = ?");
+    holdQuery.bindValue(0, medicineId);
+    holdQuery.bindValue(1, m_terminalId);
+    if (quantity > 0) {
+        holdQuery.bindValue(2, quantity);
+        holdQuery.bindValue(3, now + HoldSeconds);
+    }
+    QSqlQuery& renewQuery = cachedQuery("UPDATE StockHolds SET expiresAt = ? WHERE terminalId = ?");
+    renewQuery.bindValue(0, now + HoldSeconds);
+    renewQuery.bindValue(1, m_terminalId);
+    if (!holdQuery.exec() || !renewQuery.exec()) {
+        qDebug() << "Failed to record stock hold:" << holdQuery.lastError().text() << renewQuery.lastError().text();
+        m_db.rollback();
+        return hold;
+    }
+
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit stock hold:" << m_db.lastError().text();
+        m_db.rollback();
+        return hold;
+    }
+    hold.status = StockHold::Held;
+    return hold;
+}
+
+bool DatabaseManager::releaseStock(int medicineId)
+{
+    TRACE_SCOPE("db", "DatabaseManager::releaseStock");
+    LATENCY_SCOPE("db.releaseStock");
+    QSqlQuery& query = cachedQuery("DELETE FROM StockHolds WHERE medicineId = ? AND terminalId = ?");
+    query.bindValue(0, medicineId);
+    query.bindValue(1, m_terminalId);
+    if (!query.exec()) {
+        qDebug() << "Failed to release hold on medicine ID" << medicineId << ":" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::releaseAllHolds()
+{
+    TRACE_SCOPE("db", "DatabaseManager::releaseAllHolds");
+    LATENCY_SCOPE("db.releaseAllHolds");
+    QSqlQuery& query = cachedQuery("DELETE FROM StockHolds WHERE terminalId = ?");
+    query.bindValue(0, m_terminalId);
+    if (!query.exec()) {
+        qDebug() << "Failed to release stock holds:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+qint64 DatabaseManager::createInvoice(const QList<QPair<int, int>>& cartItems, QList<int> *shortMedicineIds)
+{
+    TRACE_SCOPE("db", "DatabaseManager::createInvoice");
+    LATENCY_SCOPE("db.createInvoice");
+    // The cart is handed to SQLite as JSON arrays of [medicineId, quantity] so every
+    // step below is one set-based statement, whatever the number of lines.
+    QJsonArray lines;
+    QHash<int, int> soldPerMedicine;
+    for (const auto& item : cartItems) {
+        lines.append(QJsonArray{item.first, item.second});
+        soldPerMedicine[item.first] += item.second;
+    }
+    QJsonArray totals;
+    MedicineChangeSet changes;
+    for (auto it = soldPerMedicine.cbegin(); it != soldPerMedicine.cend(); ++it) {
+        totals.append(QJsonArray{it.key(), it.value()});
+        changes.updated.append(it.key());
+    }
+    const QString totalsJson = QString::fromUtf8(QJsonDocument(totals).toJson(QJsonDocument::Compact));
+    const QDateTime saleTime = QDateTime::currentDateTime();
+    const qint64 now = saleTime.toSecsSinceEpoch();
+
     // A transaction ensures that all queries succeed or none do.
     // This prevents a partial sale from being recorded if one query fails.
-    if (!m_db.transaction()) {
-        qDebug() << "Failed to start transaction:" << m_db.lastError().text();
+    if (!beginImmediate()) {
         return -1;
     }
 
-    // 1. Create the Invoice record
-    QSqlQuery invoiceQuery;
-    invoiceQuery.prepare("INSERT INTO Invoices (saleDate, totalAmount) VALUES (:date, :total)");
-    invoiceQuery.bindValue(":date", QDateTime::currentDateTime().toString(Qt::ISODate));
-    invoiceQuery.bindValue(":total", totalAmount);
+    // 0. With the write lock held, find lines that other terminals' holds or
+    // sales have left short. Reporting them all beats failing on the first.
+    QSqlQuery& shortQuery = cachedQuery(QString("SELECT s.id FROM (SELECT json_extract(value, '$[0]') AS id, "
+                                                "                         json_extract(value, '$[1]') AS sold "
+                                                "                  FROM json_each(?)) AS s "
+                                                "LEFT JOIN Medicines ON Medicines.id = s.id "
+                                                "WHERE Medicines.id IS NULL OR Medicines.quantity - %1 < s.sold").arg(OtherHoldsSql));
+    shortQuery.bindValue(0, totalsJson);
+    shortQuery.bindValue(1, m_terminalId);
+    shortQuery.bindValue(2, now);
+    if (!shortQuery.exec()) {
+        qDebug() << "Failed to check stock:" << shortQuery.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+    QList<int> shortIds;
+    while (shortQuery.next()) shortIds.append(shortQuery.value(0).toInt());
+    shortQuery.finish();
+    if (!shortIds.isEmpty()) {
+        qDebug() << "Insufficient stock for medicine IDs" << shortIds << "; rolling back.";
+        if (shortMedicineIds) *shortMedicineIds = shortIds;
+        m_db.rollback();
+        return -1;
+    }
+
+    // 1. Create the Invoice record, totalled in cents from the prices being charged
+    QSqlQuery& invoiceQuery = cachedQuery("INSERT INTO Invoices (saleDate, totalCents) "
+                                          "SELECT ?, COALESCE(SUM(json_extract(s.value, '$[1]') * m.priceCents), 0) "
+                                          "FROM json_each(?) AS s "
+                                          "JOIN Medicines m ON m.id = json_extract(s.value, '$[0]')");
+    invoiceQuery.bindValue(0, saleTime.toString(Qt::ISODate));
+    invoiceQuery.bindValue(1, totalsJson);
 
     if (!invoiceQuery.exec()) {
         qDebug() << "Failed to create invoice:" << invoiceQuery.lastError().text();
@@ -176,130 +657,384 @@ qint64 DatabaseManager::createInvoice(double totalAmount, const QList<QPair<int,
     }
     qint64 invoiceId = invoiceQuery.lastInsertId().toLongLong();
 
-    // 2. Create InvoiceItems records and update stock
-    for (const auto& item : cartItems) {
-        int medicineId = item.first;
-        int quantitySold = item.second;
-
-        // Get current price
-        QSqlQuery priceQuery;
-        priceQuery.prepare("SELECT price FROM Medicines WHERE id = :id");
-        priceQuery.bindValue(":id", medicineId);
-        priceQuery.exec();
-        double priceAtSale = 0.0;
-        if (priceQuery.next()) {
-            priceAtSale = priceQuery.value(0).toDouble();
-        }
+    // 2. Take the stock for every medicine at once. The guard repeats step 0's
+    // check so the statement can never drive stock negative on its own.
+    QSqlQuery& stockQuery = cachedQuery(QString("UPDATE Medicines SET quantity = quantity - s.sold "
+                                                "FROM (SELECT json_extract(value, '$[0]') AS id, "
+                                                "             json_extract(value, '$[1]') AS sold "
+                                                "      FROM json_each(?)) AS s "
+                                                "WHERE Medicines.id = s.id AND Medicines.quantity - %1 >= s.sold").arg(OtherHoldsSql));
+    stockQuery.bindValue(0, totalsJson);
+    stockQuery.bindValue(1, m_terminalId);
+    stockQuery.bindValue(2, now);
+    if (!stockQuery.exec()) {
+        qDebug() << "Failed to update stock:" << stockQuery.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+    if (stockQuery.numRowsAffected() != totals.size()) {
+        qDebug() << "Insufficient stock for invoice; rolling back.";
+        m_db.rollback();
+        return -1;
+    }
 
-        // Insert into InvoiceItems
-        QSqlQuery itemQuery;
-        itemQuery.prepare("INSERT INTO InvoiceItems (invoiceId, medicineId, quantitySold, priceAtSale) "
-                          "VALUES (:invoiceId, :medicineId, :quantity, :price)");
-        itemQuery.bindValue(":invoiceId", invoiceId);
-        itemQuery.bindValue(":medicineId", medicineId);
-        itemQuery.bindValue(":quantity", quantitySold);
-        itemQuery.bindValue(":price", priceAtSale);
-
-        if (!itemQuery.exec()) {
-            qDebug() << "Failed to add item to invoice:" << itemQuery.lastError().text();
-            m_db.rollback();
-            return -1;
-        }
+    // 3. Record all lines in one INSERT ... SELECT, which also captures the current prices
+    QSqlQuery& itemQuery = cachedQuery("INSERT INTO InvoiceItems (invoiceId, medicineId, quantitySold, priceAtSaleCents) "
+                                       "SELECT ?, m.id, json_extract(c.value, '$[1]'), m.priceCents "
+                                       "FROM json_each(?) AS c "
+                                       "JOIN Medicines m ON m.id = json_extract(c.value, '$[0]') "
+                                       "ORDER BY c.key");
+    itemQuery.bindValue(0, invoiceId);
+    itemQuery.bindValue(1, QString::fromUtf8(QJsonDocument(lines).toJson(QJsonDocument::Compact)));
+    if (!itemQuery.exec()) {
+        qDebug() << "Failed to add items to invoice:" << itemQuery.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
 
-        // Update the stock quantity
-        if (!updateMedicineQuantity(medicineId, quantitySold)) {
-            m_db.rollback();
-            return -1;
-        }
+    // 4. The sold stock is gone, so the holds that reserved it are too
+    QSqlQuery& releaseQuery = cachedQuery("DELETE FROM StockHolds WHERE terminalId = ? AND medicineId IN "
+                                          "(SELECT json_extract(value, '$[0]') FROM json_each(?))");
+    releaseQuery.bindValue(0, m_terminalId);
+    releaseQuery.bindValue(1, totalsJson);
+    if (!releaseQuery.exec()) {
+        qDebug() << "Failed to release stock holds:" << releaseQuery.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+
+    // 5. Fold the new lines into the sales rollups, keyed by the same day as saleDate
+    const qint64 saleDay = saleTime.date().toJulianDay();
+    QSqlQuery& dailyQuery = cachedQuery("INSERT INTO DailySales (day, invoiceCount, unitsSold, revenueCents) "
+                                        "SELECT ?, 1, COALESCE(SUM(quantitySold), 0), COALESCE(SUM(quantitySold * priceAtSaleCents), 0) "
+                                        "FROM InvoiceItems WHERE invoiceId = ? "
+                                        "ON CONFLICT(day) DO UPDATE SET invoiceCount = invoiceCount + 1, "
+                                        "unitsSold = unitsSold + excluded.unitsSold, revenueCents = revenueCents + excluded.revenueCents");
+    dailyQuery.bindValue(0, saleDay);
+    dailyQuery.bindValue(1, invoiceId);
+    QSqlQuery& medicineDailyQuery = cachedQuery("INSERT INTO DailyMedicineSales (day, medicineId, unitsSold, revenueCents) "
+                                                "SELECT ?, medicineId, SUM(quantitySold), SUM(quantitySold * priceAtSaleCents) "
+                                                "FROM InvoiceItems WHERE invoiceId = ? GROUP BY medicineId "
+                                                "ON CONFLICT(day, medicineId) DO UPDATE SET "
+                                                "unitsSold = unitsSold + excluded.unitsSold, revenueCents = revenueCents + excluded.revenueCents");
+    medicineDailyQuery.bindValue(0, saleDay);
+    medicineDailyQuery.bindValue(1, invoiceId);
+    if (!dailyQuery.exec() || !medicineDailyQuery.exec()) {
+        qDebug() << "Failed to update sales rollups:" << dailyQuery.lastError().text() << medicineDailyQuery.lastError().text();
+        m_db.rollback();
+        return -1;
     }
 
     // If everything succeeded, commit the transaction
     if (!m_db.commit()) {
         qDebug() << "Failed to commit transaction:" << m_db.lastError().text();
+        m_db.rollback();
         return -1;
     }
 
+    // Only announce the stock changes once they are durable
+    emit medicinesChanged(changes);
+
     return invoiceId;
 }
 
 
-bool DatabaseManager::updateMedicine(int id, const QString& name, const QString& batch, const QString& expiry, int qty, double price)
+bool DatabaseManager::updateMedicine(int id, const QString& name, const QString& batch, const QString& expiry, int readQty, int qty, double price)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE Medicines SET name = :name, batchNumber = :batch, "
-                  "expiryDate = :expiry, quantity = :qty, price = :price WHERE id = :id");
-    query.bindValue(":name", name);
-    query.bindValue(":batch", batch);
-    query.bindValue(":expiry", expiry);
-    query.bindValue(":qty", qty);
-    query.bindValue(":price", price);
-    query.bindValue(":id", id);
-    if(query.exec()) return true;
-    qDebug() << "Failed to update medicine:" << query.lastError();
-    return false;
+    TRACE_SCOPE("db", "DatabaseManager::updateMedicine");
+    LATENCY_SCOPE("db.updateMedicine");
+    // Same guard as subtractQuantity(), applied only when the edit takes stock away
+    const int delta = qty - readQty;
+    QSqlQuery& query = cachedQuery(QString("UPDATE Medicines SET name = ?, batchNumber = ?, expiryDay = ?, "
+                                           "quantity = quantity + ?, priceCents = ? "
+                                           "WHERE id = ? AND (? >= 0 OR quantity + ? - %1 >= 0)").arg(OtherHoldsSql));
+    query.bindValue(0, name);
+    query.bindValue(1, batch);
+    query.bindValue(2, expiryDayValue(expiry));
+    query.bindValue(3, delta);
+    query.bindValue(4, Money::toCents(price));
+    query.bindValue(5, id);
+    query.bindValue(6, delta);
+    query.bindValue(7, delta);
+    query.bindValue(8, m_terminalId);
+    query.bindValue(9, QDateTime::currentSecsSinceEpoch());
+    if (!query.exec()) {
+        qDebug() << "Failed to update medicine:" << query.lastError();
+        return false;
+    }
+    if (query.numRowsAffected() != 1) {
+        qDebug() << "Insufficient unreserved stock to edit medicine ID" << id;
+        return false;
+    }
+    MedicineChangeSet changes;
+    changes.updated.append(id);
+    emit medicinesChanged(changes);
+    return true;
 }
 
 bool DatabaseManager::addStock(int id, int quantityToAdd)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE Medicines SET quantity = quantity + :qty WHERE id = :id");
-    query.bindValue(":qty", quantityToAdd);
-    query.bindValue(":id", id);
-    if(query.exec()) return true;
+    TRACE_SCOPE("db", "DatabaseManager::addStock");
+    LATENCY_SCOPE("db.addStock");
+    QSqlQuery& query = cachedQuery("UPDATE Medicines SET quantity = quantity + ? WHERE id = ?");
+    query.bindValue(0, quantityToAdd);
+    query.bindValue(1, id);
+    if(query.exec()) {
+        MedicineChangeSet changes;
+        changes.updated.append(id);
+        emit medicinesChanged(changes);
+        return true;
+    }
     qDebug() << "Failed to add stock:" << query.lastError();
     return false;
 }
 
 QList<QVariantList> DatabaseManager::getInvoices()
 {
+    TRACE_SCOPE("db", "DatabaseManager::getInvoices");
+    LATENCY_SCOPE("db.getInvoices");
     QList<QVariantList> invoices;
-    QSqlQuery query("SELECT id, saleDate, totalAmount FROM Invoices ORDER BY id DESC");
+    QSqlQuery query(m_db);
+    query.exec("SELECT id, saleDate, totalCents FROM Invoices ORDER BY id DESC");
     while (query.next()) {
-        invoices.append({query.value(0), query.value(1), query.value(2)});
+        invoices.append({query.value(0), query.value(1), Money::fromCents(query.value(2).toLongLong())});
     }
     return invoices;
 }
 
+QList<InvoiceSummary> DatabaseManager::getInvoicePage(const InvoiceFilter& filter, const InvoiceSummary& after, int limit)
+{
+    TRACE_SCOPE("db", "DatabaseManager::getInvoicePage");
+    LATENCY_SCOPE("db.getInvoicePage");
+    // Every combination of criteria is its own statement shape, so each one is
+    // prepared once and cached. The (saleDate, totalCents) index covers the date
+    // and total tests; the (medicineId, invoiceId) index drives the medicine test.
+    QString sql = "SELECT i.id, i.saleDate, i.totalCents FROM Invoices i WHERE 1";
+    QVariantList values;
+    if (after.id > 0) {
+        sql += " AND i.saleDate <= ? AND (i.saleDate < ? OR i.id < ?)";
+        values << after.saleDate << after.saleDate << after.id;
+    }
+    if (filter.from.isValid()) {
+        sql += " AND i.saleDate >= ?";
+        values << filter.from.toString(Qt::ISODate);
+    }
+    if (filter.to.isValid()) {
+        sql += " AND i.saleDate < ?";
+        values << filter.to.addDays(1).toString(Qt::ISODate);
+    }
+    if (filter.minTotalCents >= 0) {
+        sql += " AND i.totalCents >= ?";
+        values << filter.minTotalCents;
+    }
+    if (filter.maxTotalCents >= 0) {
+        sql += " AND i.totalCents <= ?";
+        values << filter.maxTotalCents;
+    }
+    if (filter.medicineId > 0) {
+        sql += " AND i.id IN (SELECT invoiceId FROM InvoiceItems WHERE medicineId = ?)";
+        values << filter.medicineId;
+    }
+    sql += " ORDER BY i.saleDate DESC, i.id DESC LIMIT ?";
+    values << limit;
+
+    QList<InvoiceSummary> page;
+    QSqlQuery& query = cachedQuery(sql);
+    for (int i = 0; i < values.size(); ++i) query.bindValue(i, values.at(i));
+    if (!query.exec()) {
+        qDebug() << "Failed to fetch invoices:" << query.lastError().text();
+        return page;
+    }
+    page.reserve(limit);
+    while (query.next()) {
+        page.append({query.value(0).toLongLong(), query.value(1).toString(), query.value(2).toLongLong()});
+    }
+    query.finish();
+    return page;
+}
+
 QList<QVariantList> DatabaseManager::getInvoiceDetails(qint64 invoiceId)
 {
+    TRACE_SCOPE("db", "DatabaseManager::getInvoiceDetails");
+    LATENCY_SCOPE("db.getInvoiceDetails");
     QList<QVariantList> details;
-    QSqlQuery query;
-    query.prepare("SELECT m.name, i.quantitySold, i.priceAtSale "
-                  "FROM InvoiceItems i JOIN Medicines m ON i.medicineId = m.id "
-                  "WHERE i.invoiceId = :id");
-    query.bindValue(":id", invoiceId);
+    QSqlQuery& query = cachedQuery("SELECT m.name, i.quantitySold, i.priceAtSaleCents, m.id "
+                                   "FROM InvoiceItems i JOIN Medicines m ON i.medicineId = m.id "
+                                   "WHERE i.invoiceId = ?");
+    query.bindValue(0, invoiceId);
     query.exec();
     while (query.next()) {
-        details.append({query.value(0), query.value(1), query.value(2)});
+        details.append({query.value(0), query.value(1), Money::fromCents(query.value(2).toLongLong()), query.value(3)});
+    }
+    query.finish();
+    return details;
+}
+
+QHash<qint64, QList<QVariantList>> DatabaseManager::getInvoiceDetails(const QList<qint64>& invoiceIds)
+{
+    TRACE_SCOPE("db", "DatabaseManager::getInvoiceDetails(batch)");
+    LATENCY_SCOPE("db.getInvoiceDetails.batch");
+    QHash<qint64, QList<QVariantList>> details;
+    QJsonArray ids;
+    for (qint64 id : invoiceIds) {
+        ids.append(id);
+        details.insert(id, {}); // invoices without lines still get an (empty) entry
+    }
+
+    QSqlQuery& query = cachedQuery("SELECT i.invoiceId, m.name, i.quantitySold, i.priceAtSaleCents, m.id "
+                                   "FROM InvoiceItems i JOIN Medicines m ON i.medicineId = m.id "
+                                   "WHERE i.invoiceId IN (SELECT value FROM json_each(?)) "
+                                   "ORDER BY i.invoiceId, i.id");
+    query.bindValue(0, QString::fromUtf8(QJsonDocument(ids).toJson(QJsonDocument::Compact)));
+    if (!query.exec()) {
+        qDebug() << "Failed to fetch invoice details:" << query.lastError().text();
+        return {};
+    }
+    while (query.next()) {
+        details[query.value(0).toLongLong()].append({query.value(1), query.value(2),
+                                                     Money::fromCents(query.value(3).toLongLong()), query.value(4)});
     }
+    query.finish();
     return details;
 }
 
 
+QList<SalesDay> DatabaseManager::getDailySales(const QDate& from, const QDate& to)
+{
+    TRACE_SCOPE("db", "DatabaseManager::getDailySales");
+    LATENCY_SCOPE("db.getDailySales");
+    QList<SalesDay> days;
+    QSqlQuery& query = cachedQuery("SELECT day, invoiceCount, unitsSold, revenueCents FROM DailySales "
+                                   "WHERE day BETWEEN ? AND ? ORDER BY day");
+    query.bindValue(0, from.toJulianDay());
+    query.bindValue(1, to.toJulianDay());
+    if (!query.exec()) {
+        qDebug() << "Failed to read daily sales:" << query.lastError().text();
+        return days;
+    }
+    while (query.next()) {
+        days.append({QDate::fromJulianDay(query.value(0).toLongLong()), query.value(1).toInt(),
+                     query.value(2).toLongLong(), query.value(3).toLongLong()});
+    }
+    query.finish();
+    return days;
+}
+
+QList<MedicineSales> DatabaseManager::getTopMedicines(const QDate& from, const QDate& to, int limit)
+{
+    TRACE_SCOPE("db", "DatabaseManager::getTopMedicines");
+    LATENCY_SCOPE("db.getTopMedicines");
+    QList<MedicineSales> medicines;
+    QSqlQuery& query = cachedQuery("SELECT s.medicineId, COALESCE(m.name, ''), s.units, s.revenue "
+                                   "FROM (SELECT medicineId, SUM(unitsSold) AS units, SUM(revenueCents) AS revenue "
+                                   "      FROM DailyMedicineSales WHERE day BETWEEN ? AND ? GROUP BY medicineId) AS s "
+                                   "LEFT JOIN Medicines m ON m.id = s.medicineId "
+                                   "ORDER BY s.revenue DESC, s.units DESC, s.medicineId LIMIT ?");
+    query.bindValue(0, from.toJulianDay());
+    query.bindValue(1, to.toJulianDay());
+    query.bindValue(2, limit);
+    if (!query.exec()) {
+        qDebug() << "Failed to read top medicines:" << query.lastError().text();
+        return medicines;
+    }
+    while (query.next()) {
+        medicines.append({query.value(0).toInt(), query.value(1).toString(),
+                          query.value(2).toLongLong(), query.value(3).toLongLong()});
+    }
+    query.finish();
+    return medicines;
+}
+
+QList<SalesDay> DatabaseManager::getMedicineDailySales(int medicineId, const QDate& from, const QDate& to)
+{
+    TRACE_SCOPE("db", "DatabaseManager::getMedicineDailySales");
+    LATENCY_SCOPE("db.getMedicineDailySales");
+    QList<SalesDay> days;
+    QSqlQuery& query = cachedQuery("SELECT day, unitsSold, revenueCents FROM DailyMedicineSales "
+                                   "WHERE medicineId = ? AND day BETWEEN ? AND ? ORDER BY day");
+    query.bindValue(0, medicineId);
+    query.bindValue(1, from.toJulianDay());
+    query.bindValue(2, to.toJulianDay());
+    if (!query.exec()) {
+        qDebug() << "Failed to read medicine sales:" << query.lastError().text();
+        return days;
+    }
+    while (query.next()) {
+        days.append({QDate::fromJulianDay(query.value(0).toLongLong()), 0,
+                     query.value(1).toLongLong(), query.value(2).toLongLong()});
+    }
+    query.finish();
+    return days;
+}
+
+bool DatabaseManager::rebuildSalesRollups()
+{
+    TRACE_SCOPE("db", "DatabaseManager::rebuildSalesRollups");
+    LATENCY_SCOPE("db.rebuildSalesRollups");
+    // Under the write lock, so no sale can land between the wipe and the refill
+    if (!beginImmediate()) return false;
+    QSqlQuery query(m_db);
+    for (const QString& statement : SchemaMigration::salesRollupRebuild()) {
+        if (!query.exec(statement)) {
+            qDebug() << "Failed to rebuild sales rollups:" << query.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit sales rollups:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
 bool DatabaseManager::deleteMedicine(int id)
 {
+    TRACE_SCOPE("db", "DatabaseManager::deleteMedicine");
+    LATENCY_SCOPE("db.deleteMedicine");
     // Important: Prevent deletion if the medicine is part of any past sale
-    // This maintains data integrity.
-    QSqlQuery checkQuery;
-    checkQuery.prepare("SELECT COUNT(*) FROM InvoiceItems WHERE medicineId = :id");
-    checkQuery.bindValue(":id", id);
-    if (checkQuery.exec() && checkQuery.next()) {
-        if (checkQuery.value(0).toInt() > 0) {
-            qDebug() << "Cannot delete medicine ID" << id << "as it is part of existing invoices.";
-            return false; // Deletion failed because it's in use
-        }
+    // This maintains data integrity. The check and the delete share the write
+    // lock, so no other terminal can sell the medicine in between.
+    if (!beginImmediate()) return false;
+
+    QSqlQuery& checkQuery = cachedQuery("SELECT COUNT(*) FROM InvoiceItems WHERE medicineId = ?");
+    checkQuery.bindValue(0, id);
+    if (!checkQuery.exec() || !checkQuery.next()) {
+        qDebug() << "Failed to check invoices for medicine:" << checkQuery.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    const bool inUse = checkQuery.value(0).toInt() > 0;
+    checkQuery.finish();
+    if (inUse) {
+        qDebug() << "Cannot delete medicine ID" << id << "as it is part of existing invoices.";
+        m_db.rollback();
+        return false; // Deletion failed because it's in use
     }
 
-    // If it's not in any invoices, proceed with deletion
-    QSqlQuery deleteQuery;
-    deleteQuery.prepare("DELETE FROM Medicines WHERE id = :id");
-    deleteQuery.bindValue(":id", id);
+    // If it's not in any invoices, proceed with deletion, taking every
+    // terminal's holds on it along
+    QSqlQuery& holdsQuery = cachedQuery("DELETE FROM StockHolds WHERE medicineId = ?");
+    holdsQuery.bindValue(0, id);
+    QSqlQuery& deleteQuery = cachedQuery("DELETE FROM Medicines WHERE id = ?");
+    deleteQuery.bindValue(0, id);
+    if (!holdsQuery.exec() || !deleteQuery.exec()) {
+        qDebug() << "Failed to delete medicine:" << holdsQuery.lastError().text() << deleteQuery.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    const bool deleted = deleteQuery.numRowsAffected() == 1;
 
-    if (deleteQuery.exec()) {
-        qDebug() << "Successfully deleted medicine ID" << id;
-        return true;
-    } else {
-        qDebug() << "Failed to delete medicine:" << deleteQuery.lastError().text();
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit medicine deletion:" << m_db.lastError().text();
+        m_db.rollback();
         return false;
     }
+    if (!deleted) return false;
+
+    MedicineChangeSet changes;
+    changes.deleted.append(id);
+    emit medicinesChanged(changes);
+    return true;
 }
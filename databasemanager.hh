@@ -1,35 +1,249 @@
 #ifndef DATABASEMANAGER_H
 #define DATABASEMANAGER_H
 
+#include <QObject>
 #include <QSqlDatabase>
 #include <QString>
 #include <QList>
+#include <QHash>
 #include <QVariant>
+#include <QDate>
+#include <QSqlQuery>
+#include <unordered_map>
+#include "databaseprofile.h"
+#include "stockstore.h"
 
-class DatabaseManager
+// Medicine IDs touched by one committed operation
+struct MedicineChangeSet
 {
+    QList<int> inserted;
+    QList<int> updated;
+    QList<int> deleted;
+    // Current values of the inserted and updated medicines, read on the
+    // connection that wrote them; filled in by AsyncDatabase
+    StockStore rows;
+
+    bool isEmpty() const { return inserted.isEmpty() && updated.isEmpty() && deleted.isEmpty(); }
+};
+Q_DECLARE_METATYPE(MedicineChangeSet)
+
+// Outcome of reserving stock for a cart line
+struct StockHold
+{
+    enum Status { Held, Insufficient, NotFound, Failed };
+
+    Status status = Failed;
+    int available = 0; // units this terminal may hold right now, counting its own hold
+};
+Q_DECLARE_METATYPE(StockHold)
+
+// One row of the sales history list
+struct InvoiceSummary
+{
+    qint64 id = 0;
+    QString saleDate;
+    qint64 totalCents = 0;
+};
+
+// Sales history search criteria; unset fields do not filter
+struct InvoiceFilter
+{
+    QDate from;                  // first sale day included
+    QDate to;                    // last sale day included
+    qint64 minTotalCents = -1;
+    qint64 maxTotalCents = -1;
+    int medicineId = 0;          // only invoices with a line for this medicine
+
+    bool isEmpty() const
+    {
+        return !from.isValid() && !to.isValid() && minTotalCents < 0 && maxTotalCents < 0 && medicineId <= 0;
+    }
+};
+
+// One validated catalog line for DatabaseManager::importMedicines()
+struct MedicineRecord
+{
+    QString name;
+    QString batchNumber;
+    QDate expiry;        // invalid: no expiry recorded
+    int quantity = 0;
+    qint64 priceCents = 0;
+};
+
+// What importMedicines() did with a batch of records
+struct ImportBatchResult
+{
+    bool ok = false;     // false: the whole batch was rolled back
+    int inserted = 0;
+    int updated = 0;
+    int skipped = 0;     // batch number already in stock under SkipDuplicates
+};
+
+// One line of a delivery note. Lines name a medicine by ID, or by batch
+// number when medicineId is 0; an unknown batch becomes a new medicine from
+// name, expiry and priceCents.
+struct ReceiptLine
+{
+    int medicineId = 0;
+    QString batchNumber;
+    int quantity = 0;       // units received, > 0
+    QString name;           // new batches only; required with expiry and a price above zero
+    QDate expiry;
+    qint64 priceCents = 0;
+};
+
+// Outcome of DatabaseManager::receiveGoods()
+struct GoodsReceiptResult
+{
+    bool ok = false;
+    int updated = 0;            // existing medicines restocked
+    int created = 0;            // new batches added
+    QList<int> rejectedLines;   // indices of lines that could not be applied; nothing was applied when this is non-empty
+};
+Q_DECLARE_METATYPE(GoodsReceiptResult)
+
+// One day of sales, read from the DailySales rollup
+struct SalesDay
+{
+    QDate day;
+    int invoiceCount = 0;
+    qint64 unitsSold = 0;
+    qint64 revenueCents = 0;
+};
+
+// One medicine's sales over a date range, read from the DailyMedicineSales rollup
+struct MedicineSales
+{
+    int medicineId = 0;
+    QString name;
+    qint64 unitsSold = 0;
+    qint64 revenueCents = 0;
+};
+
+class DatabaseManager : public QObject
+{
+    Q_OBJECT
+
 public:
-    explicit DatabaseManager();
+    // Uses the default connection and database/medicare.db
+    explicit DatabaseManager(QObject *parent = nullptr);
+    // Opens databasePath (or the default file when empty) on its own named
+    // connection, e.g. for a worker thread
+    DatabaseManager(const QString& connectionName, const QString& databasePath, QObject *parent = nullptr);
+    ~DatabaseManager();
+
+    QString connectionName() const { return m_db.connectionName(); }
+    QString databasePath() const { return m_db.databaseName(); }
+    // Absolute path of database/medicare.db, creating its folder; opens no connection
+    static QString defaultDatabasePath();
 
-    // Initializes the database, creates tables if they don't exist
+    // Connection settings used by initDatabase(); defaults to DatabaseProfile::fromEnvironment()
+    void setProfile(const DatabaseProfile& profile) { m_profile = profile; }
+    const DatabaseProfile& profile() const { return m_profile; }
+
+    // Identifies this counter's stock holds; defaults to defaultTerminalId()
+    void setTerminalId(const QString& terminalId) { m_terminalId = terminalId; }
+    const QString& terminalId() const { return m_terminalId; }
+    // MEDICARE_TERMINAL_ID if set, otherwise host name and process ID
+    static QString defaultTerminalId();
+
+    // Holds expire unless the terminal touches its cart again within this time
+    static constexpr int HoldSeconds = 15 * 60;
+
+    // Opens the database and brings its schema up to date (see SchemaMigration)
     bool initDatabase();
+    // PRAGMA user_version: the last migration applied, or -1 on error
+    int schemaVersion();
 
-    // Adds a new medicine to the database
+    // How importMedicines() treats a record whose batch number is already in stock.
+    // UpdateDuplicates refreshes name, expiry and price but keeps the quantity.
+    enum DuplicateBatch { SkipDuplicates, UpdateDuplicates };
+
+    // Adds a new medicine to the database. Expiry is "yyyy-MM-dd" and price is
+    // rounded to cents; both are stored as integers (see SchemaMigration 3).
     bool addMedicine(const QString& name, const QString& batchNumber, const QString& expiryDate, int quantity, double price);
     QList<QVariantList> getAllMedicines();
+    // Streams the Medicines table straight into a columnar store (no per-row QVariantList)
+    bool loadMedicines(StockStore& store);
+    // Re-reads only the given medicines into the store (inserting or overwriting)
+    bool loadMedicines(StockStore& store, const QList<int>& ids);
+
+    // Writes a batch of catalog records in one transaction through reused
+    // prepared statements. Records are matched to existing stock by batch
+    // number, including earlier records of the same batch. Does not emit
+    // medicinesChanged; reload the stock after a bulk import instead.
+    ImportBatchResult importMedicines(const QList<MedicineRecord>& records, DuplicateBatch duplicates);
+
+    // Books a whole delivery in one transaction: adds each line's units to its
+    // medicine, creating new batches as needed, and emits one change set for all
+    // of them. If any line is invalid or names an unknown medicine without the
+    // details to create it, nothing is applied and rejectedLines lists them all.
+    GoodsReceiptResult receiveGoods(const QList<ReceiptLine>& lines);
 
-    qint64 createInvoice(double totalAmount, const QList<QPair<int, int>>& cartItems);
+    // Sets this terminal's hold on a medicine to quantity units (0 releases it).
+    // Stock held by other terminals is not available; renews all of our holds.
+    StockHold holdStock(int medicineId, int quantity);
+    bool releaseStock(int medicineId);
+    bool releaseAllHolds();
 
+    // Sells the cart atomically at the current prices, consuming this terminal's holds.
+    // Returns -1 if nothing was sold; shortMedicineIds then lists lines other terminals got to first.
+    qint64 createInvoice(const QList<QPair<int, int>>& cartItems, QList<int> *shortMedicineIds = nullptr);
+
+    // Fails (returns false) rather than taking stock below zero or below other terminals' holds
     bool updateMedicineQuantity(int medicineId, int quantityToSubtract);
 
-    bool updateMedicine(int id, const QString& name, const QString& batch, const QString& expiry, int qty, double price);
+    // qty is applied as a change from readQty, the quantity the editor started
+    // from, so sales committed meanwhile are kept. A reduction fails (returns
+    // false) rather than going below other terminals' holds.
+    bool updateMedicine(int id, const QString& name, const QString& batch, const QString& expiry, int readQty, int qty, double price);
     bool addStock(int id, int quantityToAdd);
     bool deleteMedicine(int id);
     QList<QVariantList> getInvoices();
+    // Up to limit invoices matching filter, newest sale first, that come after the
+    // row `after` (after.id == 0: start at the newest). Paging on (saleDate, id)
+    // rather than OFFSET keeps every page an index range scan, however deep.
+    QList<InvoiceSummary> getInvoicePage(const InvoiceFilter& filter, const InvoiceSummary& after, int limit);
+    // Lines of an invoice: name, quantity sold, price at sale, medicine ID
     QList<QVariantList> getInvoiceDetails(qint64 invoiceId);
+    // The same for several invoices in one query, keyed by invoice ID
+    QHash<qint64, QList<QVariantList>> getInvoiceDetails(const QList<qint64>& invoiceIds);
+
+    // Sales analytics, answered from the rollup tables createInvoice keeps current,
+    // so the cost grows with the days in range rather than the invoice lines.
+    // Days without sales are omitted; ranges include both ends.
+    QList<SalesDay> getDailySales(const QDate& from, const QDate& to);
+    // Best sellers by revenue, then units
+    QList<MedicineSales> getTopMedicines(const QDate& from, const QDate& to, int limit);
+    // One medicine day by day; invoiceCount is left at 0
+    QList<SalesDay> getMedicineDailySales(int medicineId, const QDate& from, const QDate& to);
+    // Recomputes the rollups from Invoices and InvoiceItems, e.g. after a restore
+    bool rebuildSalesRollups();
+
+signals:
+    // Emitted after every successful write to the Medicines table
+    void medicinesChanged(const MedicineChangeSet& changes);
 
 private:
+    bool subtractQuantity(int medicineId, int quantityToSubtract);
+    bool applyProfile();
+    bool migrate();
+    // Takes the write lock up front so check-then-write sequences cannot
+    // interleave with another terminal's
+    bool beginImmediate();
+
+    // Returns the compiled statement for sql, preparing it on first use only.
+    // Statements use positional '?' bindings and stay alive for the connection's lifetime.
+    // A statement that fails to prepare is not cached.
+    QSqlQuery& cachedQuery(const QString& sql);
+
     QSqlDatabase m_db;
+    DatabaseProfile m_profile;
+    QString m_terminalId;
+    // Declared after m_db so the statements are finalized before the connection goes away.
+    // std::unordered_map keeps references stable when other statements are added.
+    std::unordered_map<QString, QSqlQuery> m_statements;
+    QSqlQuery m_failedStatement; // last statement that failed to prepare
     static const QString DB_PATH; // Store the database path as a constant
 };
 
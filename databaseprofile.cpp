@@ -0,0 +1,53 @@
+#include "databaseprofile.h"
+#include <QtGlobal>
+
+DatabaseProfile DatabaseProfile::durable()
+{
+    return {"durable", "WAL", "FULL", 8 * 1024, 0, "DEFAULT", 5000};
+}
+
+DatabaseProfile DatabaseProfile::balanced()
+{
+    return {"balanced", "WAL", "NORMAL", 64 * 1024, qint64(256) * 1024 * 1024, "MEMORY", 5000};
+}
+
+DatabaseProfile DatabaseProfile::throughput()
+{
+    return {"throughput", "WAL", "OFF", 256 * 1024, qint64(1024) * 1024 * 1024, "MEMORY", 10000};
+}
+
+DatabaseProfile DatabaseProfile::bulkRead()
+{
+    return {"bulkRead", "WAL", "NORMAL", 2 * 1024, 0, "FILE", 5000};
+}
+
+DatabaseProfile DatabaseProfile::fromName(const QString& name)
+{
+    const QString key = name.trimmed().toLower();
+    if (key == "balanced") return balanced();
+    if (key == "throughput") return throughput();
+    return durable();
+}
+
+DatabaseProfile DatabaseProfile::fromEnvironment()
+{
+    return fromName(qEnvironmentVariable("MEDICARE_DB_PROFILE", "durable"));
+}
+
+QStringList DatabaseProfile::presetNames()
+{
+    return {"durable", "balanced", "throughput"};
+}
+
+QStringList DatabaseProfile::pragmas() const
+{
+    // busy_timeout goes first so the journal mode switch can wait out other connections
+    return {
+        QString("PRAGMA busy_timeout = %1").arg(busyTimeoutMs),
+        QString("PRAGMA journal_mode = %1").arg(journalMode),
+        QString("PRAGMA synchronous = %1").arg(synchronous),
+        QString("PRAGMA cache_size = -%1").arg(cacheSizeKiB),
+        QString("PRAGMA mmap_size = %1").arg(mmapSizeBytes),
+        QString("PRAGMA temp_store = %1").arg(tempStore)
+    };
+}
@@ -0,0 +1,47 @@
+#ifndef DATABASEPROFILE_H
+#define DATABASEPROFILE_H
+
+#include <QString>
+#include <QStringList>
+
+// SQLite connection settings applied right after the database is opened.
+// Pick a preset by name with the MEDICARE_DB_PROFILE environment variable.
+//
+// durable is the default because a till must not lose a sale it has shown
+// as paid. balanced trades that away: with synchronous=NORMAL a power cut can
+// roll back the last few committed invoices (the file stays intact). Choose
+// it only where that loss is acceptable, after comparing the presets with
+// tools/dbbench --profile on the target machine.
+struct DatabaseProfile
+{
+    QString name;
+    QString journalMode;   // PRAGMA journal_mode: WAL, DELETE, ...
+    QString synchronous;   // PRAGMA synchronous: FULL, NORMAL, OFF
+    int cacheSizeKiB;      // PRAGMA cache_size (applied as a negative, i.e. KiB)
+    qint64 mmapSizeBytes;  // PRAGMA mmap_size; 0 disables memory-mapped I/O
+    QString tempStore;     // PRAGMA temp_store: DEFAULT, FILE, MEMORY
+    int busyTimeoutMs;     // PRAGMA busy_timeout
+
+    // Every commit is fsync'd; readers still never block the writer. The default.
+    static DatabaseProfile durable();
+    // WAL with fsync only at checkpoints: a power cut can lose the last
+    // few commits but never corrupts the file
+    static DatabaseProfile balanced();
+    // Large caches and no fsync, for bulk imports and benchmarking
+    static DatabaseProfile throughput();
+    // One pass over large tables (exports): no memory mapping, a small page
+    // cache and temp tables on disk, so the scan does not grow the RSS.
+    // Not selectable by name.
+    static DatabaseProfile bulkRead();
+
+    // Preset by name (case-insensitive); unknown names fall back to durable()
+    static DatabaseProfile fromName(const QString& name);
+    // Preset named by MEDICARE_DB_PROFILE, or durable()
+    static DatabaseProfile fromEnvironment();
+    static QStringList presetNames();
+
+    // PRAGMA statements that realise this profile, in the order they must run
+    QStringList pragmas() const;
+};
+
+#endif // DATABASEPROFILE_H
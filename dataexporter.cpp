@@ -0,0 +1,239 @@
+#include "dataexporter.h"
+#include "databasemanager.h"
+#include "columnarfile.h"
+#include "money.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+namespace {
+
+// How a stored integer reads in CSV; the columnar files keep the raw value
+enum CsvStyle { PlainValue, JulianDate, Cents };
+
+struct ExportColumn
+{
+    const char *name;       // columnar column name, as stored in the database
+    const char *csvHeader;
+    Columnar::Type type;
+    CsvStyle style;
+};
+
+struct ExportSpec
+{
+    DataExporter::Dataset dataset;
+    const char *fileStem;
+    const char *sql;
+    QList<ExportColumn> columns;
+};
+
+const QList<ExportSpec>& exportSpecs()
+{
+    static const QList<ExportSpec> specs = {
+        {DataExporter::Invoices, "invoices",
+         "SELECT id, saleDate, totalCents FROM Invoices ORDER BY id", {
+             {"id", "id", Columnar::Int64, PlainValue},
+             {"saleDate", "saleDate", Columnar::Utf8, PlainValue},
+             {"totalCents", "total", Columnar::Int64, Cents},
+         }},
+        {DataExporter::InvoiceItems, "invoice_items",
+         "SELECT id, invoiceId, medicineId, quantitySold, priceAtSaleCents FROM InvoiceItems ORDER BY id", {
+             {"id", "id", Columnar::Int64, PlainValue},
+             {"invoiceId", "invoiceId", Columnar::Int64, PlainValue},
+             {"medicineId", "medicineId", Columnar::Int64, PlainValue},
+             {"quantitySold", "quantitySold", Columnar::Int64, PlainValue},
+             {"priceAtSaleCents", "priceAtSale", Columnar::Int64, Cents},
+         }},
+        {DataExporter::Stock, "stock",
+         "SELECT id, name, batchNumber, expiryDay, quantity, priceCents FROM Medicines ORDER BY id", {
+             {"id", "id", Columnar::Int64, PlainValue},
+             {"name", "name", Columnar::Utf8, PlainValue},
+             {"batchNumber", "batchNumber", Columnar::Utf8, PlainValue},
+             {"expiryDay", "expiry", Columnar::Int64, JulianDate},
+             {"quantity", "quantity", Columnar::Int64, PlainValue},
+             {"priceCents", "price", Columnar::Int64, Cents},
+         }},
+    };
+    return specs;
+}
+
+void appendCsvField(QByteArray& line, const QByteArray& field)
+{
+    if (field.contains(',') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        line.append('"');
+        line.append(QByteArray(field).replace("\"", "\"\""));
+        line.append('"');
+    } else {
+        line.append(field);
+    }
+}
+
+QByteArray csvValue(const QVariant& value, const ExportColumn& column)
+{
+    if (value.isNull()) return QByteArray();
+    if (column.type == Columnar::Utf8) return value.toString().toUtf8();
+    switch (column.style) {
+    case JulianDate: return QDate::fromJulianDay(value.toLongLong()).toString("yyyy-MM-dd").toUtf8();
+    case Cents: return Money::format(value.toLongLong()).toUtf8();
+    case PlainValue: break;
+    }
+    return QByteArray::number(value.toLongLong());
+}
+
+}
+
+DataExporter::DataExporter(const QString& databasePath, QObject *parent)
+    : QObject(parent), m_databasePath(databasePath)
+{
+}
+
+DataExporter::~DataExporter()
+{
+    cancel();
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool DataExporter::start(const QString& directory, Datasets datasets, Format format)
+{
+    if (m_running) return false;
+    // The previous run has emitted finished() and is at most returning
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+    m_running = true;
+    m_cancelled = false;
+    m_thread = QThread::create([this, directory, datasets, format]() { run(directory, datasets, format); });
+    m_thread->setObjectName("DataExport");
+    m_thread->start();
+    return true;
+}
+
+void DataExporter::run(const QString& directory, Datasets datasets, Format format)
+{
+    QStringList files;
+    QString error;
+
+    // Connection names must be unique per process
+    static QAtomicInt instanceCounter;
+    const QString connectionName = QString("medicare-export-%1").arg(instanceCounter.fetchAndAddRelaxed(1));
+    {
+        DatabaseManager db(connectionName, m_databasePath);
+        db.setProfile(DatabaseProfile::bulkRead());
+        QSqlDatabase connection = QSqlDatabase::database(connectionName, false);
+        if (!db.initDatabase()) {
+            error = "Failed to open the database";
+        } else if (!connection.transaction()) {
+            error = "Failed to start a read transaction: " + connection.lastError().text();
+        }
+
+        QElapsedTimer sinceProgress;
+        sinceProgress.start();
+        for (const ExportSpec& spec : exportSpecs()) {
+            if (!error.isEmpty()) break;
+            if (!datasets.testFlag(spec.dataset)) continue;
+
+            const QString fileName = QString("%1.%2").arg(spec.fileStem, format == Csv ? "csv" : "mcol");
+            const QString path = QDir(directory).filePath(fileName);
+            QSqlQuery query(connection);
+            // Forward-only keeps the driver from caching rows already read
+            query.setForwardOnly(true);
+            if (!query.exec(spec.sql)) {
+                error = QString("Failed to read %1: %2").arg(spec.fileStem, query.lastError().text());
+                break;
+            }
+
+            QSaveFile csvFile(path);
+            ColumnarWriter columnar;
+            QByteArray buffer;
+            bool opened = false;
+            if (format == Csv) {
+                opened = csvFile.open(QIODevice::WriteOnly);
+                buffer.reserve(CsvBufferBytes + 4096);
+                for (int i = 0; i < spec.columns.size(); ++i) {
+                    if (i > 0) buffer.append(',');
+                    buffer.append(spec.columns.at(i).csvHeader);
+                }
+                buffer.append('\n');
+            } else {
+                QList<Columnar::Column> columns;
+                for (const ExportColumn& column : spec.columns) columns.append({column.name, column.type});
+                opened = columnar.open(path, columns);
+            }
+            if (!opened) {
+                error = QString("Cannot write %1: %2").arg(path, format == Csv ? csvFile.errorString() : columnar.errorString());
+                break;
+            }
+
+            qint64 rows = 0;
+            bool written = true;
+            while (written && query.next()) {
+                if (format == Csv) {
+                    for (int i = 0; i < spec.columns.size(); ++i) {
+                        if (i > 0) buffer.append(',');
+                        appendCsvField(buffer, csvValue(query.value(i), spec.columns.at(i)));
+                    }
+                    buffer.append('\n');
+                    if (buffer.size() >= CsvBufferBytes) {
+                        written = csvFile.write(buffer) == buffer.size();
+                        buffer.clear();
+                    }
+                } else {
+                    for (int i = 0; i < spec.columns.size(); ++i) {
+                        const QVariant value = query.value(i);
+                        if (spec.columns.at(i).type == Columnar::Utf8) {
+                            columnar.appendString(i, value.toString().toUtf8());
+                        } else {
+                            columnar.appendInt64(i, value.isNull() ? Columnar::NullInt64 : value.toLongLong());
+                        }
+                    }
+                    written = columnar.endRow();
+                }
+
+                // Checking the clock on every row would cost more than the row
+                if (++rows % 4096 == 0) {
+                    if (m_cancelled) {
+                        error = "Export cancelled";
+                        break;
+                    }
+                    if (sinceProgress.elapsed() >= ProgressIntervalMs) {
+                        emit progress(fileName, rows);
+                        sinceProgress.restart();
+                    }
+                }
+            }
+            if (written && error.isEmpty() && query.lastError().isValid()) {
+                error = QString("Failed to read %1: %2").arg(spec.fileStem, query.lastError().text());
+            }
+
+            if (format == Csv) {
+                if (written && error.isEmpty()) written = csvFile.write(buffer) == buffer.size() && csvFile.commit();
+                else csvFile.cancelWriting();
+            } else {
+                if (written && error.isEmpty()) written = columnar.commit();
+                else columnar.cancel();
+            }
+            query.finish();
+            if (!written && error.isEmpty()) {
+                error = QString("Failed to write %1: %2").arg(path, format == Csv ? csvFile.errorString() : columnar.errorString());
+            }
+            if (!error.isEmpty()) break;
+
+            files.append(path);
+            emit progress(fileName, rows);
+        }
+        if (connection.isOpen()) connection.commit();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    m_running = false;
+    emit finished(error.isEmpty(), files, error);
+}
@@ -0,0 +1,66 @@
+#ifndef DATAEXPORTER_H
+#define DATAEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+class QThread;
+
+// Writes invoices, invoice lines and the current stock out of the database in
+// the background, as CSV or as columnar .mcol files (see ColumnarWriter).
+//
+// Rows are streamed from forward-only queries straight into the output, so
+// memory stays at one write buffer or one row group per file however long the
+// sales history is. All datasets are read inside one read transaction and
+// therefore describe the same moment. Each file only replaces an existing one
+// of the same name once it has been written completely.
+class DataExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format { Csv, Columnar };
+
+    enum Dataset {
+        Invoices = 0x1,
+        InvoiceItems = 0x2,
+        Stock = 0x4,
+        AllDatasets = Invoices | InvoiceItems | Stock
+    };
+    Q_DECLARE_FLAGS(Datasets, Dataset)
+
+    static constexpr int CsvBufferBytes = 1 << 20;
+
+    // An empty databasePath opens the same file as the default DatabaseManager
+    explicit DataExporter(const QString& databasePath = QString(), QObject *parent = nullptr);
+    // Cancels a running export and waits for it
+    ~DataExporter();
+
+    // Writes invoices, invoice_items and stock (.csv or .mcol) into directory;
+    // false if an export is already running
+    bool start(const QString& directory, Datasets datasets, Format format);
+    void cancel() { m_cancelled = true; }
+    bool isRunning() const { return m_running; }
+
+signals:
+    // Rows written so far to the file being written; emitted from the export thread
+    void progress(const QString& fileName, qint64 rows);
+    // files lists what was written, also when a later file failed
+    void finished(bool ok, const QStringList& files, const QString& error);
+
+private:
+    static constexpr int ProgressIntervalMs = 100;
+
+    void run(const QString& directory, Datasets datasets, Format format);
+
+    QString m_databasePath;
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancelled{false};
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DataExporter::Datasets)
+
+#endif // DATAEXPORTER_H
@@ -0,0 +1,135 @@
+#include "diagnosticsdialog.h"
+#include "metrics.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QLabel>
+#include <QTimer>
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
+#include <QMessageBox>
+
+namespace {
+
+QString formatMicros(double micros)
+{
+    if (micros < 1000) return QString("%1 µs").arg(qRound64(micros));
+    if (micros < 1000000) return QString("%1 ms").arg(micros / 1000, 0, 'f', 2);
+    return QString("%1 s").arg(micros / 1000000, 0, 'f', 2);
+}
+
+QTableWidgetItem *numberItem(const QString& text)
+{
+    QTableWidgetItem *item = new QTableWidgetItem(text);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+}
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Diagnostics");
+    setMinimumSize(900, 600);
+    setupUI();
+
+    // Ticks only while the dialog is on screen; closing it merely hides it
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(RefreshIntervalMs);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DiagnosticsDialog::refresh);
+}
+
+void DiagnosticsDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    refresh();
+    m_refreshTimer->start();
+}
+
+void DiagnosticsDialog::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer->stop();
+    QDialog::hideEvent(event);
+}
+
+void DiagnosticsDialog::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    m_latencyTable = new QTableWidget(0, 8, this);
+    m_latencyTable->setHorizontalHeaderLabels({"Layer", "Operation", "Count", "Mean", "p50", "p95", "p99", "Max"});
+    m_counterTable = new QTableWidget(0, 2, this);
+    m_counterTable->setHorizontalHeaderLabels({"Counter", "Value"});
+    for (QTableWidget *table : {m_latencyTable, m_counterTable}) {
+        table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        table->setSelectionBehavior(QAbstractItemView::SelectRows);
+        table->verticalHeader()->setVisible(false);
+        table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+        table->horizontalHeader()->setStretchLastSection(true);
+    }
+
+    QPushButton *resetButton = new QPushButton("Reset", this);
+    QPushButton *dumpButton = new QPushButton("Dump to File...", this);
+    QPushButton *closeButton = new QPushButton("Close", this);
+    connect(resetButton, &QPushButton::clicked, this, &DiagnosticsDialog::onResetClicked);
+    connect(dumpButton, &QPushButton::clicked, this, &DiagnosticsDialog::onDumpClicked);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(resetButton);
+    buttonLayout->addWidget(dumpButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+
+    mainLayout->addWidget(new QLabel("Latency per operation since start or the last reset", this));
+    mainLayout->addWidget(m_latencyTable, 3);
+    mainLayout->addWidget(new QLabel("Counters", this));
+    mainLayout->addWidget(m_counterTable, 1);
+    mainLayout->addLayout(buttonLayout);
+}
+
+void DiagnosticsDialog::refresh()
+{
+    const QList<HistogramSnapshot> histograms = Metrics::histograms();
+    m_latencyTable->setRowCount(histograms.size());
+    for (int row = 0; row < histograms.size(); ++row) {
+        const HistogramSnapshot& snapshot = histograms.at(row);
+        const int dot = snapshot.name.indexOf('.');
+        m_latencyTable->setItem(row, 0, new QTableWidgetItem(dot > 0 ? snapshot.name.left(dot) : QString()));
+        m_latencyTable->setItem(row, 1, new QTableWidgetItem(snapshot.name.mid(dot + 1)));
+        m_latencyTable->setItem(row, 2, numberItem(QString::number(snapshot.count)));
+        const bool empty = snapshot.count == 0;
+        m_latencyTable->setItem(row, 3, numberItem(empty ? QString() : formatMicros(snapshot.meanMicros)));
+        m_latencyTable->setItem(row, 4, numberItem(empty ? QString() : formatMicros(snapshot.p50Micros)));
+        m_latencyTable->setItem(row, 5, numberItem(empty ? QString() : formatMicros(snapshot.p95Micros)));
+        m_latencyTable->setItem(row, 6, numberItem(empty ? QString() : formatMicros(snapshot.p99Micros)));
+        m_latencyTable->setItem(row, 7, numberItem(empty ? QString() : formatMicros(snapshot.maxMicros)));
+    }
+
+    const QList<CounterSnapshot> counters = Metrics::counters();
+    m_counterTable->setRowCount(counters.size());
+    for (int row = 0; row < counters.size(); ++row) {
+        m_counterTable->setItem(row, 0, new QTableWidgetItem(counters.at(row).name));
+        m_counterTable->setItem(row, 1, numberItem(QString::number(counters.at(row).value)));
+    }
+}
+
+void DiagnosticsDialog::onResetClicked()
+{
+    Metrics::reset();
+    refresh();
+}
+
+void DiagnosticsDialog::onDumpClicked()
+{
+    const QString suggested = QDir::home().filePath(
+        QString("medicare-metrics-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")));
+    const QString path = QFileDialog::getSaveFileName(this, "Dump Metrics", suggested, "JSON files (*.json)");
+    if (path.isEmpty()) return;
+    if (!Metrics::dump(path)) {
+        QMessageBox::critical(this, "Dump Failed", QString("Could not write %1.").arg(path));
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include <QDialog>
+
+class QTableWidget;
+class QTimer;
+
+// Live view of the metrics registry for support staff: latency percentiles
+// per operation, grouped by layer (db, ui, checkout, net), and the counters.
+// Opened from the main window with Ctrl+Shift+D; it has no menu entry.
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    static constexpr int RefreshIntervalMs = 1000;
+
+    explicit DiagnosticsDialog(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+    void onResetClicked();
+    void onDumpClicked();
+
+private:
+    void setupUI();
+
+    QTableWidget *m_latencyTable;
+    QTableWidget *m_counterTable;
+    QTimer *m_refreshTimer;
+};
+
+#endif // DIAGNOSTICSDIALOG_H
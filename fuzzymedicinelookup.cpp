@@ -0,0 +1,273 @@
+#include "fuzzymedicinelookup.h"
+#include "stockstore.h"
+#include <QSet>
+#include <algorithm>
+#include <limits>
+
+void FuzzyMedicineLookup::clear()
+{
+    m_words.clear();
+    m_wordIds.clear();
+    m_wordRows.clear();
+    m_rowWords.clear();
+    m_deletes.clear();
+    m_phonetic.clear();
+}
+
+void FuzzyMedicineLookup::rebuild(const StockStore& store)
+{
+    clear();
+    m_rowWords.resize(store.size());
+    for (int i = 0; i < store.size(); ++i) {
+        if (!store.isRemoved(i)) addRow(store, i);
+    }
+}
+
+void FuzzyMedicineLookup::update(const StockStore& store, int storeIndex)
+{
+    if (storeIndex >= m_rowWords.size()) m_rowWords.resize(storeIndex + 1);
+
+    // Stock and price edits leave the name alone; skip the re-index then
+    const QStringList nameWords = words(store.name(storeIndex));
+    const QVector<int>& current = m_rowWords.at(storeIndex);
+    if (current.size() == nameWords.size()) {
+        bool same = true;
+        for (int k = 0; k < current.size() && same; ++k) same = m_words.at(current.at(k)) == nameWords.at(k);
+        if (same) return;
+    }
+
+    removeRow(storeIndex);
+    addRow(store, storeIndex);
+}
+
+void FuzzyMedicineLookup::remove(int storeIndex)
+{
+    if (storeIndex < m_rowWords.size()) removeRow(storeIndex);
+}
+
+QVector<FuzzyMedicineLookup::Match> FuzzyMedicineLookup::lookup(const QString& text, int maxResults) const
+{
+    QVector<Match> results;
+    const QStringList queryWords = words(text);
+    if (queryWords.isEmpty() || maxResults <= 0) return results;
+
+    QVector<QHash<int, int>> wordCandidates;
+    for (const QString& word : queryWords) wordCandidates.append(candidates(word));
+
+    // Drive the scan from the query word whose candidates cover the fewest rows
+    int driver = -1;
+    qint64 driverRows = std::numeric_limits<qint64>::max();
+    for (int k = 0; k < wordCandidates.size(); ++k) {
+        if (wordCandidates.at(k).isEmpty()) continue;
+        qint64 rows = 0;
+        for (auto it = wordCandidates.at(k).cbegin(); it != wordCandidates.at(k).cend(); ++it) {
+            rows += m_wordRows.at(it.key()).size();
+        }
+        if (rows < driverRows) {
+            driverRows = rows;
+            driver = k;
+        }
+    }
+    if (driver < 0) return results;
+
+    QSet<int> seen;
+    const QHash<int, int>& driverCandidates = wordCandidates.at(driver);
+    for (auto it = driverCandidates.cbegin(); it != driverCandidates.cend(); ++it) {
+        for (int row : m_wordRows.at(it.key())) {
+            if (seen.contains(row)) continue;
+            seen.insert(row);
+
+            Match match{row, 0, 0};
+            for (const QHash<int, int>& perWord : wordCandidates) {
+                int best = -1;
+                for (int id : m_rowWords.at(row)) {
+                    auto found = perWord.constFind(id);
+                    if (found != perWord.constEnd() && (best < 0 || found.value() < best)) best = found.value();
+                }
+                if (best >= 0) {
+                    match.matchedWords++;
+                    match.distance += best;
+                }
+            }
+            results.append(match);
+        }
+    }
+
+    auto better = [](const Match& a, const Match& b) {
+        if (a.matchedWords != b.matchedWords) return a.matchedWords > b.matchedWords;
+        if (a.distance != b.distance) return a.distance < b.distance;
+        return a.storeIndex < b.storeIndex;
+    };
+    if (results.size() > maxResults) {
+        std::partial_sort(results.begin(), results.begin() + maxResults, results.end(), better);
+        results.resize(maxResults);
+    } else {
+        std::sort(results.begin(), results.end(), better);
+    }
+    return results;
+}
+
+int FuzzyMedicineLookup::editDistance(const QString& a, const QString& b, int maxDistance)
+{
+    // Optimal string alignment distance (adjacent swaps count as one edit),
+    // abandoned as soon as every cell in a row exceeds maxDistance
+    const int n = a.size(), m = b.size();
+    if (qAbs(n - m) > maxDistance) return maxDistance + 1;
+
+    QVector<int> previous2(m + 1), previous(m + 1), current(m + 1);
+    for (int j = 0; j <= m; ++j) previous[j] = j;
+
+    for (int i = 1; i <= n; ++i) {
+        current[0] = i;
+        int rowMin = current[0];
+        for (int j = 1; j <= m; ++j) {
+            const int cost = a.at(i - 1) == b.at(j - 1) ? 0 : 1;
+            int value = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && a.at(i - 1) == b.at(j - 2) && a.at(i - 2) == b.at(j - 1)) {
+                value = std::min(value, previous2[j - 2] + 1);
+            }
+            current[j] = value;
+            rowMin = std::min(rowMin, value);
+        }
+        if (rowMin > maxDistance) return maxDistance + 1;
+        std::swap(previous2, previous);
+        std::swap(previous, current);
+    }
+    return std::min(previous[m], maxDistance + 1);
+}
+
+QString FuzzyMedicineLookup::phoneticKey(const QString& word)
+{
+    // Consonant skeleton with common drug-name sound-alikes merged:
+    // ph/f, c/k/q, x/ks, z/s; vowels and h are kept only as the first letter.
+    QString key;
+    auto push = [&key](QChar c) {
+        if (key.isEmpty() || key.back() != c) key.append(c);
+    };
+    for (int i = 0; i < word.size(); ++i) {
+        const QChar c = word.at(i);
+        const QChar next = i + 1 < word.size() ? word.at(i + 1) : QChar();
+        const bool first = key.isEmpty();
+        switch (c.unicode()) {
+        case 'a': case 'e': case 'i': case 'o': case 'u': case 'y': case 'h':
+            if (first) push(c == 'y' ? QChar('i') : c);
+            break;
+        case 'p':
+            if (next == QChar('h')) { push('f'); ++i; } else push('p');
+            break;
+        case 'c': case 'k': case 'q':
+            push('k');
+            break;
+        case 'x':
+            push('k');
+            push('s');
+            break;
+        case 'z':
+            push('s');
+            break;
+        default:
+            if (c.isLetterOrNumber()) push(c);
+            break;
+        }
+    }
+    return key;
+}
+
+QStringList FuzzyMedicineLookup::words(const QString& text)
+{
+    QStringList result;
+    const QString folded = text.toCaseFolded();
+    QString word;
+    auto flush = [&result, &word]() {
+        bool hasLetter = std::any_of(word.cbegin(), word.cend(), [](QChar c) { return c.isLetter(); });
+        if (word.size() >= 3 && hasLetter && !result.contains(word)) result.append(word);
+        word.clear();
+    };
+    for (QChar c : folded) {
+        if (c.isLetterOrNumber()) word.append(c);
+        else flush();
+    }
+    flush();
+    return result;
+}
+
+QStringList FuzzyMedicineLookup::deleteVariants(const QString& word)
+{
+    QSet<QString> variants{word.left(PrefixLength)};
+    QStringList frontier{word.left(PrefixLength)};
+    for (int distance = 0; distance < MaxEditDistance; ++distance) {
+        QStringList next;
+        for (const QString& variant : frontier) {
+            if (variant.size() <= 1) continue;
+            for (int i = 0; i < variant.size(); ++i) {
+                QString deleted = variant;
+                deleted.remove(i, 1);
+                if (!variants.contains(deleted)) {
+                    variants.insert(deleted);
+                    next.append(deleted);
+                }
+            }
+        }
+        frontier = next;
+    }
+    return QStringList(variants.cbegin(), variants.cend());
+}
+
+int FuzzyMedicineLookup::wordId(const QString& word)
+{
+    auto it = m_wordIds.constFind(word);
+    if (it != m_wordIds.constEnd()) return it.value();
+
+    const int id = m_words.size();
+    m_words.append(word);
+    m_wordIds.insert(word, id);
+    m_wordRows.append(QVector<int>());
+    for (const QString& variant : deleteVariants(word)) m_deletes[variant].append(id);
+    m_phonetic[phoneticKey(word)].append(id);
+    return id;
+}
+
+void FuzzyMedicineLookup::addRow(const StockStore& store, int storeIndex)
+{
+    QVector<int> ids;
+    for (const QString& word : words(store.name(storeIndex))) {
+        const int id = wordId(word);
+        ids.append(id);
+        m_wordRows[id].append(storeIndex);
+    }
+    m_rowWords[storeIndex] = ids;
+}
+
+void FuzzyMedicineLookup::removeRow(int storeIndex)
+{
+    for (int id : m_rowWords.at(storeIndex)) m_wordRows[id].removeOne(storeIndex);
+    m_rowWords[storeIndex].clear();
+}
+
+QHash<int, int> FuzzyMedicineLookup::candidates(const QString& queryWord) const
+{
+    QHash<int, int> result;
+    // Short words tolerate a single typo, longer ones two
+    const int maxDistance = queryWord.size() <= 4 ? 1 : MaxEditDistance;
+
+    for (const QString& variant : deleteVariants(queryWord)) {
+        auto it = m_deletes.constFind(variant);
+        if (it == m_deletes.constEnd()) continue;
+        for (int id : it.value()) {
+            if (result.contains(id) || m_wordRows.at(id).isEmpty()) continue;
+            const int distance = editDistance(queryWord, m_words.at(id), maxDistance);
+            if (distance <= maxDistance) result.insert(id, distance);
+        }
+    }
+
+    // Sound-alike words may be a little further away in spelling
+    auto it = m_phonetic.constFind(phoneticKey(queryWord));
+    if (it != m_phonetic.constEnd()) {
+        for (int id : it.value()) {
+            if (result.contains(id) || m_wordRows.at(id).isEmpty()) continue;
+            const int distance = editDistance(queryWord, m_words.at(id), MaxEditDistance + 1);
+            if (distance <= MaxEditDistance + 1) result.insert(id, distance);
+        }
+    }
+    return result;
+}
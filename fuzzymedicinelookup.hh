@@ -0,0 +1,58 @@
+#ifndef FUZZYMEDICINELOOKUP_H
+#define FUZZYMEDICINELOOKUP_H
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+class StockStore;
+
+// Typo-tolerant lookup over medicine names ("amoxicilin" -> "Amoxicillin").
+// Every distinct name word is indexed SymSpell-style: all variants with up to
+// MaxEditDistance characters deleted from its first PrefixLength characters
+// point back to the word, so candidates for a misspelling are found with a
+// few hash lookups instead of comparing against every word. Words are also
+// grouped by a coarse phonetic key to catch sound-alike spellings.
+class FuzzyMedicineLookup
+{
+public:
+    struct Match {
+        int storeIndex;
+        int matchedWords;  // query words that found a close name word
+        int distance;      // summed edit distance of those words
+    };
+
+    static constexpr int MaxEditDistance = 2;
+    static constexpr int PrefixLength = 7;
+
+    void clear();
+    void rebuild(const StockStore& store);
+    void update(const StockStore& store, int storeIndex);
+    void remove(int storeIndex);
+
+    // Best matches first: most query words matched, then smallest distance
+    QVector<Match> lookup(const QString& text, int maxResults) const;
+
+    static int editDistance(const QString& a, const QString& b, int maxDistance);
+    static QString phoneticKey(const QString& word);
+
+private:
+    static QStringList words(const QString& text);
+    static QStringList deleteVariants(const QString& word);
+
+    int wordId(const QString& word);
+    void addRow(const StockStore& store, int storeIndex);
+    void removeRow(int storeIndex);
+    // Word IDs close to a query word, with their edit distance
+    QHash<int, int> candidates(const QString& queryWord) const;
+
+    QVector<QString> m_words;               // word ID -> folded word
+    QHash<QString, int> m_wordIds;
+    QVector<QVector<int>> m_wordRows;       // word ID -> store indices using it
+    QVector<QVector<int>> m_rowWords;       // store index -> word IDs in its name
+    QHash<QString, QVector<int>> m_deletes; // delete variant -> word IDs
+    QHash<QString, QVector<int>> m_phonetic; // phonetic key -> word IDs
+};
+
+#endif // FUZZYMEDICINELOOKUP_H
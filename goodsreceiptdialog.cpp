@@ -0,0 +1,165 @@
+#include "goodsreceiptdialog.h"
+#include "goodsreceiptmodel.h"
+#include "money.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QTableView>
+#include <QHeaderView>
+#include <QItemSelectionModel>
+#include <QLabel>
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QLocale>
+#include <QMessageBox>
+#include <QDialogButtonBox>
+
+GoodsReceiptDialog::GoodsReceiptDialog(AsyncDatabase *database, const StockStore *store, QWidget *parent)
+    : QDialog(parent), m_database(database), m_model(new GoodsReceiptModel(store, this))
+{
+    setWindowTitle("Receive Goods");
+    setMinimumSize(900, 600);
+    setupUI();
+    connect(m_model, &GoodsReceiptModel::totalsChanged, this, &GoodsReceiptDialog::updateSummary);
+    updateSummary();
+}
+
+void GoodsReceiptDialog::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // Scanners type the batch number and press Enter
+    QHBoxLayout *entryLayout = new QHBoxLayout();
+    m_batchEdit = new QLineEdit(this);
+    m_batchEdit->setPlaceholderText("Scan or type a batch number");
+    m_quantitySpinBox = new QSpinBox(this);
+    m_quantitySpinBox->setRange(1, 999999);
+    m_quantitySpinBox->setPrefix("Qty ");
+    QPushButton *addButton = new QPushButton("Add Line", this);
+    QPushButton *pasteButton = new QPushButton("Paste Lines", this);
+    QPushButton *removeButton = new QPushButton("Remove Selected", this);
+    connect(m_batchEdit, &QLineEdit::returnPressed, this, &GoodsReceiptDialog::onAddLineClicked);
+    connect(addButton, &QPushButton::clicked, this, &GoodsReceiptDialog::onAddLineClicked);
+    connect(pasteButton, &QPushButton::clicked, this, &GoodsReceiptDialog::onPasteClicked);
+    connect(removeButton, &QPushButton::clicked, this, &GoodsReceiptDialog::onRemoveClicked);
+    entryLayout->addWidget(m_batchEdit, 1);
+    entryLayout->addWidget(m_quantitySpinBox);
+    entryLayout->addWidget(addButton);
+    entryLayout->addWidget(pasteButton);
+    entryLayout->addWidget(removeButton);
+
+    m_linesTable = new QTableView(this);
+    m_linesTable->setModel(m_model);
+    m_linesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_linesTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_linesTable->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+    m_linesTable->verticalHeader()->setVisible(false);
+    // Fixed row heights keep a 2,000-line note as cheap to scroll as a short one
+    m_linesTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_linesTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    m_summaryLabel = new QLabel(this);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Cancel, this);
+    m_bookButton = buttonBox->addButton("Book Receipt", QDialogButtonBox::AcceptRole);
+    // Enter in the batch field adds a line; it must not book the note
+    m_bookButton->setAutoDefault(false);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &GoodsReceiptDialog::onBookClicked);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    mainLayout->addLayout(entryLayout);
+    mainLayout->addWidget(m_linesTable);
+    mainLayout->addWidget(m_summaryLabel);
+    mainLayout->addWidget(buttonBox);
+}
+
+void GoodsReceiptDialog::onAddLineClicked()
+{
+    ReceiptLine line;
+    line.batchNumber = m_batchEdit->text().trimmed();
+    line.quantity = m_quantitySpinBox->value();
+    if (line.batchNumber.isEmpty()) return;
+
+    const int row = m_model->addLines({line});
+    if (row >= 0) m_linesTable->scrollTo(m_model->index(row, GoodsReceiptModel::QuantityColumn));
+    m_batchEdit->clear();
+    m_quantitySpinBox->setValue(1);
+    m_batchEdit->setFocus();
+}
+
+void GoodsReceiptDialog::onPasteClicked()
+{
+    const QStringList rows = QGuiApplication::clipboard()->text().split('\n', Qt::SkipEmptyParts);
+    const QLocale c = QLocale::c();
+    QList<ReceiptLine> lines;
+    int skipped = 0;
+    for (const QString& row : rows) {
+        const QStringList fields = row.trimmed().split(row.contains('\t') ? QChar('\t') : QChar(','));
+        ReceiptLine line;
+        bool ok = false;
+        line.batchNumber = fields.value(0).trimmed();
+        line.quantity = fields.value(1).trimmed().toInt(&ok);
+        // Header rows and stray text have no usable quantity
+        if (!ok || line.quantity <= 0 || line.batchNumber.isEmpty()) {
+            skipped++;
+            continue;
+        }
+        line.name = fields.value(2).trimmed();
+        line.expiry = QDate::fromString(fields.value(3).trimmed(), "yyyy-MM-dd");
+        line.priceCents = Money::toCents(c.toDouble(fields.value(4).trimmed()));
+        lines.append(line);
+    }
+
+    m_model->addLines(lines);
+    if (skipped > 0) {
+        QMessageBox::information(this, "Paste Lines",
+                                 QString("Added %1 lines; %2 lines without a batch and quantity were skipped.")
+                                     .arg(lines.size()).arg(skipped));
+    }
+}
+
+void GoodsReceiptDialog::onRemoveClicked()
+{
+    QList<int> rows;
+    for (const QModelIndex& index : m_linesTable->selectionModel()->selectedRows()) rows.append(index.row());
+    m_model->removeLines(rows);
+}
+
+void GoodsReceiptDialog::onBookClicked()
+{
+    const QList<ReceiptLine> lines = m_model->lines();
+    if (lines.isEmpty()) return;
+
+    m_bookButton->setEnabled(false);
+    m_database->receiveGoods(lines).then(this, [this](const GoodsReceiptResult& result) {
+        m_bookButton->setEnabled(true);
+        if (result.ok) {
+            // The stock grid picks the changes up from the single change set
+            QMessageBox::information(this, "Goods Received",
+                                     QString("Restocked %1 medicines and added %2 new batches.")
+                                         .arg(result.updated).arg(result.created));
+            accept();
+            return;
+        }
+
+        m_model->setRejected(result.rejectedLines);
+        if (result.rejectedLines.isEmpty()) {
+            QMessageBox::critical(this, "Database Error", "The receipt could not be booked. Nothing was changed.");
+            return;
+        }
+        m_linesTable->scrollTo(m_model->index(result.rejectedLines.first(), 0));
+        QMessageBox::warning(this, "Receipt Not Booked",
+                             QString("%1 highlighted lines are new batches without a name or are no longer in stock. "
+                                     "Fix or remove them and book again; nothing was changed.")
+                                 .arg(result.rejectedLines.size()));
+    });
+}
+
+void GoodsReceiptDialog::updateSummary()
+{
+    m_summaryLabel->setText(QString("%1 lines, %2 units, %3 new batches")
+                                .arg(m_model->rowCount()).arg(m_model->totalUnits()).arg(m_model->newBatchCount()));
+    m_bookButton->setEnabled(m_model->rowCount() > 0);
+}
@@ -0,0 +1,46 @@
+#ifndef GOODSRECEIPTDIALOG_H
+#define GOODSRECEIPTDIALOG_H
+
+#include <QDialog>
+#include "asyncdatabase.h"
+
+class QLineEdit;
+class QSpinBox;
+class QTableView;
+class QLabel;
+class QPushButton;
+class StockStore;
+class GoodsReceiptModel;
+
+// Entry screen for a delivery note. Lines are scanned or typed one at a time,
+// or pasted in bulk from a spreadsheet, and the whole note is booked with a
+// single DatabaseManager::receiveGoods() call when the user confirms.
+class GoodsReceiptDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // store resolves batch numbers to medicines already in stock
+    GoodsReceiptDialog(AsyncDatabase *database, const StockStore *store, QWidget *parent = nullptr);
+
+private slots:
+    void onAddLineClicked();
+    // Tab- or comma-separated lines: batch, quantity[, name, expiry, price]
+    void onPasteClicked();
+    void onRemoveClicked();
+    void onBookClicked();
+    void updateSummary();
+
+private:
+    void setupUI();
+
+    AsyncDatabase *m_database;
+    GoodsReceiptModel *m_model;
+    QLineEdit *m_batchEdit;
+    QSpinBox *m_quantitySpinBox;
+    QTableView *m_linesTable;
+    QLabel *m_summaryLabel;
+    QPushButton *m_bookButton;
+};
+
+#endif // GOODSRECEIPTDIALOG_H
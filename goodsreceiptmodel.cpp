@@ -0,0 +1,210 @@
+#include "goodsreceiptmodel.h"
+#include "stockstore.h"
+#include "money.h"
+#include <QColor>
+#include <algorithm>
+#include <functional>
+
+GoodsReceiptModel::GoodsReceiptModel(const StockStore *store, QObject *parent)
+    : QAbstractTableModel(parent), m_store(store)
+{
+    m_stockByBatch.reserve(store->size());
+    for (int i = 0; i < store->size(); ++i) {
+        if (!store->isRemoved(i) && !m_stockByBatch.contains(store->batchNumber(i))) {
+            m_stockByBatch.insert(store->batchNumber(i), store->id(i));
+        }
+    }
+}
+
+int GoodsReceiptModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_lines.size();
+}
+
+int GoodsReceiptModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant GoodsReceiptModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_lines.size()) return QVariant();
+    const ReceiptLine& line = m_lines.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case BatchColumn: return line.batchNumber;
+        case NameColumn: return line.name;
+        case ExpiryColumn: return line.expiry.isValid() ? line.expiry.toString("yyyy-MM-dd") : QString();
+        case QuantityColumn: return line.quantity;
+        case PriceColumn: return Money::format(line.priceCents);
+        }
+        break;
+    case Qt::EditRole:
+        // Typed values pick the matching default editor (spin box, date edit)
+        switch (index.column()) {
+        case BatchColumn: return line.batchNumber;
+        case NameColumn: return line.name;
+        case ExpiryColumn: return line.expiry.isValid() ? line.expiry : QDate::currentDate();
+        case QuantityColumn: return line.quantity;
+        case PriceColumn: return Money::fromCents(line.priceCents);
+        }
+        break;
+    case Qt::BackgroundRole:
+        if (m_rejected.contains(index.row())) return QColor("#fed7d7");
+        if (line.medicineId == 0) return QColor("#fefcbf");
+        break;
+    case Qt::ToolTipRole:
+        if (m_rejected.contains(index.row())) {
+            return line.medicineId == 0 ? QString("Not booked: a new batch needs a name, an expiry and a price above zero")
+                                        : QString("This line could not be booked");
+        }
+        if (line.medicineId == 0) return QString("New batch: enter its name, expiry and price");
+        break;
+    case Qt::TextAlignmentRole:
+        if (index.column() == QuantityColumn || index.column() == PriceColumn) return int(Qt::AlignRight | Qt::AlignVCenter);
+        break;
+    }
+    return QVariant();
+}
+
+bool GoodsReceiptModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable)) return false;
+    ReceiptLine& line = m_lines[index.row()];
+
+    switch (index.column()) {
+    case NameColumn:
+        if (value.toString().trimmed().isEmpty()) return false;
+        line.name = value.toString().trimmed();
+        break;
+    case ExpiryColumn:
+        if (!value.toDate().isValid()) return false;
+        line.expiry = value.toDate();
+        break;
+    case QuantityColumn: {
+        const int quantity = value.toInt();
+        if (quantity <= 0) return false;
+        m_totalUnits += quantity - line.quantity;
+        line.quantity = quantity;
+        break;
+    }
+    case PriceColumn:
+        if (value.toDouble() < 0) return false;
+        line.priceCents = Money::toCents(value.toDouble());
+        break;
+    default:
+        return false;
+    }
+
+    m_rejected.remove(index.row());
+    emit dataChanged(this->index(index.row(), 0), this->index(index.row(), ColumnCount - 1));
+    emit totalsChanged();
+    return true;
+}
+
+QVariant GoodsReceiptModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    static const QStringList headers = {"Batch", "Medicine Name", "Expiry", "Qty Received", "Price"};
+    if (role == Qt::DisplayRole && orientation == Qt::Horizontal && section >= 0 && section < headers.size()) {
+        return headers.at(section);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags GoodsReceiptModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= m_lines.size()) return Qt::NoItemFlags;
+    Qt::ItemFlags itemFlags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    // Known batches keep their catalog details; only what arrived can change
+    const bool newBatch = m_lines.at(index.row()).medicineId == 0;
+    if (index.column() == QuantityColumn || (newBatch && index.column() != BatchColumn)) itemFlags |= Qt::ItemIsEditable;
+    return itemFlags;
+}
+
+int GoodsReceiptModel::addLines(const QList<ReceiptLine>& lines)
+{
+    int lastRow = -1;
+    QVector<ReceiptLine> appended;
+    for (ReceiptLine line : lines) {
+        line.batchNumber = line.batchNumber.trimmed();
+        if (line.batchNumber.isEmpty() || line.quantity <= 0) continue;
+        m_totalUnits += line.quantity;
+
+        auto existing = m_rowByBatch.constFind(line.batchNumber);
+        if (existing != m_rowByBatch.constEnd()) {
+            lastRow = existing.value();
+            if (lastRow < m_lines.size()) {
+                m_lines[lastRow].quantity += line.quantity;
+                emit dataChanged(index(lastRow, QuantityColumn), index(lastRow, QuantityColumn));
+            } else {
+                appended[lastRow - m_lines.size()].quantity += line.quantity;
+            }
+            continue;
+        }
+        resolve(line);
+        lastRow = m_lines.size() + appended.size();
+        m_rowByBatch.insert(line.batchNumber, lastRow);
+        appended.append(line);
+    }
+
+    if (!appended.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_lines.size(), m_lines.size() + appended.size() - 1);
+        m_lines.append(appended);
+        endInsertRows();
+    }
+    emit totalsChanged();
+    return lastRow;
+}
+
+void GoodsReceiptModel::removeLines(const QList<int>& rows)
+{
+    if (rows.isEmpty()) return;
+    QList<int> sorted = rows;
+    std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+
+    beginResetModel();
+    int previous = -1;
+    for (int row : sorted) {
+        if (row == previous || row < 0 || row >= m_lines.size()) continue;
+        m_totalUnits -= m_lines.at(row).quantity;
+        m_lines.removeAt(row);
+        previous = row;
+    }
+    m_rejected.clear();
+    rebuildBatchRows();
+    endResetModel();
+    emit totalsChanged();
+}
+
+void GoodsReceiptModel::setRejected(const QList<int>& rows)
+{
+    m_rejected = QSet<int>(rows.cbegin(), rows.cend());
+    if (!m_lines.isEmpty()) emit dataChanged(index(0, 0), index(m_lines.size() - 1, ColumnCount - 1));
+}
+
+int GoodsReceiptModel::newBatchCount() const
+{
+    return std::count_if(m_lines.cbegin(), m_lines.cend(), [](const ReceiptLine& line) { return line.medicineId == 0; });
+}
+
+void GoodsReceiptModel::resolve(ReceiptLine& line) const
+{
+    // Looked up by ID, since a full reload may have moved the medicine in the store
+    const int storeIndex = m_store->indexOfId(m_stockByBatch.value(line.batchNumber, 0));
+    if (storeIndex < 0) {
+        line.medicineId = 0;
+        return;
+    }
+    line.medicineId = m_store->id(storeIndex);
+    line.name = m_store->name(storeIndex);
+    line.expiry = m_store->expiryDate(storeIndex);
+    line.priceCents = m_store->priceCents(storeIndex);
+}
+
+void GoodsReceiptModel::rebuildBatchRows()
+{
+    m_rowByBatch.clear();
+    for (int row = 0; row < m_lines.size(); ++row) m_rowByBatch.insert(m_lines.at(row).batchNumber, row);
+}
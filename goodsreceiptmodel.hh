@@ -0,0 +1,68 @@
+#ifndef GOODSRECEIPTMODEL_H
+#define GOODSRECEIPTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include "databasemanager.h"
+
+class StockStore;
+
+// Editable lines of a delivery note being booked. Batches found in the stock
+// store are tied to their medicine and only their quantity can be edited;
+// unknown batches become new medicines and need a name, expiry and price.
+// Scanning or pasting a batch that is already listed adds to that line.
+class GoodsReceiptModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        BatchColumn = 0,
+        NameColumn,
+        ExpiryColumn,
+        QuantityColumn,
+        PriceColumn,
+        ColumnCount
+    };
+
+    // store is only read while lines are added, to resolve batch numbers
+    explicit GoodsReceiptModel(const StockStore *store, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    // Adds the lines with at most one row insertion; returns the row of the last one
+    int addLines(const QList<ReceiptLine>& lines);
+    // Removes the given rows with one reset
+    void removeLines(const QList<int>& rows);
+    // Marks rows the database refused, until they are edited
+    void setRejected(const QList<int>& rows);
+
+    const QVector<ReceiptLine>& lines() const { return m_lines; }
+    qint64 totalUnits() const { return m_totalUnits; }
+    int newBatchCount() const;
+
+signals:
+    // Line count, units or the new batch count changed
+    void totalsChanged();
+
+private:
+    // Fills medicine details from the store when the batch is in stock
+    void resolve(ReceiptLine& line) const;
+    void rebuildBatchRows();
+
+    QHash<QString, int> m_stockByBatch;  // batch number -> medicine ID, built once
+    const StockStore *m_store;
+    QVector<ReceiptLine> m_lines;
+    QHash<QString, int> m_rowByBatch;    // batch number -> row in m_lines
+    QSet<int> m_rejected;
+    qint64 m_totalUnits = 0;
+};
+
+#endif // GOODSRECEIPTMODEL_H
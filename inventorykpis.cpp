@@ -0,0 +1,106 @@
+#include "inventorykpis.h"
+#include "stockstore.h"
+#include <QDateTime>
+#include <QTimer>
+
+InventoryKpis::InventoryKpis(QObject *parent)
+    : QObject(parent), m_midnightTimer(new QTimer(this))
+{
+    m_midnightTimer->setSingleShot(true);
+    connect(m_midnightTimer, &QTimer::timeout, this, [this]() {
+        setToday(QDate::currentDate());
+        scheduleMidnight();
+        emit countsChanged();
+    });
+    const QDate today = QDate::currentDate();
+    m_today = today.toJulianDay();
+    m_soon = today.addMonths(StockStore::ExpiringSoonMonths).toJulianDay();
+    scheduleMidnight();
+}
+
+void InventoryKpis::reset(const StockStore& store)
+{
+    m_expiryCounts.clear();
+    m_lowStock.clear();
+    m_counted.fill(0, store.size());
+    m_tracked.fill(false, store.size());
+    m_total = m_expiring = 0;
+    for (int i = 0; i < store.size(); ++i) {
+        if (!store.isRemoved(i)) update(store, i);
+    }
+}
+
+void InventoryKpis::update(const StockStore& store, int storeIndex)
+{
+    if (storeIndex >= m_counted.size()) {
+        m_counted.resize(storeIndex + 1);
+        m_tracked.resize(storeIndex + 1);
+    }
+    if (m_tracked.at(storeIndex)) {
+        subtract(m_counted.at(storeIndex));
+    } else {
+        m_tracked[storeIndex] = true;
+        m_total++;
+    }
+
+    const qint64 expiryDay = store.expiryDay(storeIndex);
+    m_counted[storeIndex] = expiryDay;
+    add(expiryDay);
+    if (store.quantity(storeIndex) < StockStore::LowStockThreshold) m_lowStock.insert(storeIndex);
+    else m_lowStock.remove(storeIndex);
+}
+
+void InventoryKpis::remove(int storeIndex)
+{
+    if (storeIndex >= m_tracked.size() || !m_tracked.at(storeIndex)) return;
+    subtract(m_counted.at(storeIndex));
+    m_tracked[storeIndex] = false;
+    m_total--;
+    m_lowStock.remove(storeIndex);
+}
+
+void InventoryKpis::setToday(const QDate& day)
+{
+    const qint64 today = day.toJulianDay();
+    const qint64 soon = day.addMonths(StockStore::ExpiringSoonMonths).toJulianDay();
+    if (today >= m_today && soon >= m_soon && today <= m_soon) {
+        // Rolling forward: drop the days that fell behind, add the ones that came into reach
+        m_expiring -= countBetween(m_today, today);
+        m_expiring += countBetween(m_soon, soon);
+    } else {
+        m_expiring = countBetween(today, soon);
+    }
+    m_today = today;
+    m_soon = soon;
+}
+
+void InventoryKpis::add(qint64 expiryDay)
+{
+    m_expiryCounts[expiryDay]++;
+    if (inWindow(expiryDay)) m_expiring++;
+}
+
+void InventoryKpis::subtract(qint64 expiryDay)
+{
+    auto it = m_expiryCounts.find(expiryDay);
+    if (it == m_expiryCounts.end()) return;
+    if (--it.value() == 0) m_expiryCounts.erase(it);
+    if (inWindow(expiryDay)) m_expiring--;
+}
+
+int InventoryKpis::countBetween(qint64 from, qint64 to) const
+{
+    int count = 0;
+    for (auto it = m_expiryCounts.lowerBound(from); it != m_expiryCounts.cend() && it.key() < to; ++it) {
+        count += it.value();
+    }
+    return count;
+}
+
+void InventoryKpis::scheduleMidnight()
+{
+    // A second past midnight, so currentDate() has certainly moved on
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime next(now.date().addDays(1), QTime(0, 0, 1));
+    m_midnightTimer->start(qMax<qint64>(1000, now.msecsTo(next)));
+}
@@ -0,0 +1,64 @@
+#ifndef INVENTORYKPIS_H
+#define INVENTORYKPIS_H
+
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <QDate>
+
+class QTimer;
+class StockStore;
+
+// Counters behind the stats cards, kept up to date one medicine at a time.
+// Live medicines are bucketed by expiry day in an ordered map, so the
+// "expiring soon" count is a range sum over it; when the day changes only the
+// buckets that enter or leave the window are touched. Low-stock medicines are
+// kept as a set of store indices.
+class InventoryKpis : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InventoryKpis(QObject *parent = nullptr);
+
+    int totalMedicines() const { return m_total; }
+    int lowStockCount() const { return m_lowStock.size(); }
+    int expiringCount() const { return m_expiring; }
+    QDate today() const { return QDate::fromJulianDay(m_today); }
+
+    // Recounts every live medicine in the store
+    void reset(const StockStore& store);
+    // Re-reads one medicine after the store changed in place (new or updated)
+    void update(const StockStore& store, int storeIndex);
+    // Forgets a medicine; call before the store drops it
+    void remove(int storeIndex);
+
+    // Moves the expiring window to [day, day + StockStore::ExpiringSoonMonths).
+    // Called by the midnight timer; public so a changed clock can be picked up.
+    void setToday(const QDate& day);
+
+signals:
+    // The counters moved without a store change, i.e. the window rolled forward
+    void countsChanged();
+
+private:
+    void add(qint64 expiryDay);
+    void subtract(qint64 expiryDay);
+    bool inWindow(qint64 expiryDay) const { return expiryDay >= m_today && expiryDay < m_soon; }
+    // Medicines with expiry in [from, to)
+    int countBetween(qint64 from, qint64 to) const;
+    void scheduleMidnight();
+
+    QMap<qint64, int> m_expiryCounts; // expiry day -> live medicines expiring that day
+    QSet<int> m_lowStock;             // store indices below StockStore::LowStockThreshold
+    QVector<qint64> m_counted;        // store index -> expiry day it was counted under
+    QVector<bool> m_tracked;          // store index -> currently counted
+    int m_total = 0;
+    int m_expiring = 0;
+    qint64 m_today = 0;               // Julian days
+    qint64 m_soon = 0;
+    QTimer *m_midnightTimer;
+};
+
+#endif // INVENTORYKPIS_H
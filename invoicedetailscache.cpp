@@ -0,0 +1,126 @@
+#include "invoicedetailscache.h"
+
+namespace {
+// Columns of a line from getInvoiceDetails()
+const int NameColumn = 0;
+const int MedicineIdColumn = 3;
+}
+
+InvoiceDetailsCache::InvoiceDetailsCache(AsyncDatabase *database, int capacity, QObject *parent)
+    : QObject(parent), m_database(database), m_cache(capacity), m_indexedLinks(0), m_generation(0), m_clearedAt(0)
+{
+    connect(m_database, &AsyncDatabase::medicinesChanged, this, &InvoiceDetailsCache::onMedicinesChanged);
+}
+
+const QList<QVariantList>* InvoiceDetailsCache::find(qint64 invoiceId) const
+{
+    return m_cache.object(invoiceId);
+}
+
+QFuture<QList<QVariantList>> InvoiceDetailsCache::details(qint64 invoiceId, const QString& supersedeKey)
+{
+    if (const QList<QVariantList> *lines = find(invoiceId)) {
+        return QtFuture::makeReadyFuture(*lines);
+    }
+
+    const int generation = m_generation;
+    return m_database->getInvoiceDetails(invoiceId, supersedeKey)
+        .then(this, [this, invoiceId, generation](const QList<QVariantList>& lines) {
+            store(invoiceId, lines, generation);
+            return lines;
+        });
+}
+
+void InvoiceDetailsCache::prefetch(const QList<qint64>& invoiceIds)
+{
+    QList<qint64> missing;
+    for (qint64 id : invoiceIds) {
+        if (!m_cache.contains(id) && !m_prefetching.contains(id)) missing.append(id);
+    }
+    if (missing.isEmpty()) return;
+
+    for (qint64 id : missing) m_prefetching.insert(id);
+    const int generation = m_generation;
+    m_database->getInvoiceDetails(missing).then(this, [this, missing, generation](const QHash<qint64, QList<QVariantList>>& lines) {
+        for (qint64 id : missing) m_prefetching.remove(id);
+        for (auto it = lines.cbegin(); it != lines.cend(); ++it) store(it.key(), it.value(), generation);
+    });
+}
+
+void InvoiceDetailsCache::clear()
+{
+    m_cache.clear();
+    m_byMedicine.clear();
+    m_indexedLinks = 0;
+    m_changes.clear();
+    m_clearedAt = ++m_generation;
+}
+
+void InvoiceDetailsCache::onMedicinesChanged(const MedicineChangeSet& changes)
+{
+    if (changes.updated.isEmpty() && changes.deleted.isEmpty()) return;
+    ++m_generation;
+
+    auto invalidate = [this](int medicineId) {
+        auto entry = m_byMedicine.find(medicineId);
+        if (entry == m_byMedicine.end()) return;
+        for (qint64 invoiceId : std::as_const(entry->invoiceIds)) m_cache.remove(invoiceId);
+        m_indexedLinks -= entry->invoiceIds.size();
+        m_byMedicine.erase(entry);
+    };
+
+    for (int id : changes.deleted) {
+        m_changes.insert(id, {m_generation, true, QString()});
+        invalidate(id);
+    }
+    for (int id : changes.updated) {
+        const int row = changes.rows.indexOfId(id);
+        if (row < 0) continue;
+        const QString& name = changes.rows.name(row);
+        m_changes.insert(id, {m_generation, false, name});
+        // Quantity, price and expiry edits do not show in invoice lines
+        auto entry = m_byMedicine.constFind(id);
+        if (entry != m_byMedicine.constEnd() && entry->name != name) invalidate(id);
+    }
+}
+
+void InvoiceDetailsCache::store(qint64 invoiceId, const QList<QVariantList>& lines, int generation)
+{
+    if (generation < m_clearedAt) return;
+    for (const QVariantList& line : lines) {
+        const int medicineId = line.value(MedicineIdColumn).toInt();
+        auto change = m_changes.constFind(medicineId);
+        // Renamed or deleted after this fetch read the row
+        if (change != m_changes.constEnd() && change->generation > generation
+            && (change->deleted || change->name != line.value(NameColumn).toString())) {
+            return;
+        }
+    }
+
+    m_cache.insert(invoiceId, new QList<QVariantList>(lines));
+    for (const QVariantList& line : lines) {
+        MedicineLines& entry = m_byMedicine[line.value(MedicineIdColumn).toInt()];
+        entry.name = line.value(NameColumn).toString();
+        if (!entry.invoiceIds.contains(invoiceId)) {
+            entry.invoiceIds.insert(invoiceId);
+            ++m_indexedLinks;
+        }
+    }
+    // Evicted invoices linger in the index; sweep once they outnumber the live ones
+    if (m_indexedLinks > 8 * m_cache.maxCost()) pruneIndex();
+}
+
+void InvoiceDetailsCache::pruneIndex()
+{
+    m_indexedLinks = 0;
+    for (auto entry = m_byMedicine.begin(); entry != m_byMedicine.end();) {
+        // contains() does not touch the LRU order
+        entry->invoiceIds.removeIf([this](qint64 invoiceId) { return !m_cache.contains(invoiceId); });
+        if (entry->invoiceIds.isEmpty()) {
+            entry = m_byMedicine.erase(entry);
+        } else {
+            m_indexedLinks += entry->invoiceIds.size();
+            ++entry;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef INVOICEDETAILSCACHE_H
+#define INVOICEDETAILSCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QSet>
+#include "asyncdatabase.h"
+
+// Bounded least-recently-used cache of invoice lines (the rows returned by
+// DatabaseManager::getInvoiceDetails), shared by every sales history dialog.
+// Invoices never change once written, but their lines show the current
+// medicine name and vanish with the medicine. So entries are dropped only
+// when a medicine they mention is renamed or deleted; sales and stock
+// changes leave the cache, and fetches in flight, alone.
+class InvoiceDetailsCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultCapacity = 512; // invoices
+
+    explicit InvoiceDetailsCache(AsyncDatabase *database, int capacity = DefaultCapacity, QObject *parent = nullptr);
+
+    // The cached lines, or nullptr. Marks the entry as recently used.
+    const QList<QVariantList>* find(qint64 invoiceId) const;
+
+    // Lines from the cache when present, otherwise from the database worker
+    QFuture<QList<QVariantList>> details(qint64 invoiceId, const QString& supersedeKey = QString());
+
+    // Loads the invoices not yet cached in one background query
+    void prefetch(const QList<qint64>& invoiceIds);
+
+    void clear();
+
+private slots:
+    void onMedicinesChanged(const MedicineChangeSet& changes);
+
+private:
+    struct MedicineLines
+    {
+        QString name;                 // as shown by the cached lines
+        QSet<qint64> invoiceIds;      // may include invoices since evicted
+    };
+    struct MedicineChange
+    {
+        int generation;
+        bool deleted;
+        QString name;
+    };
+
+    void store(qint64 invoiceId, const QList<QVariantList>& lines, int generation);
+    // Drops invoices the cache has evicted from m_byMedicine
+    void pruneIndex();
+
+    AsyncDatabase *m_database;
+    QCache<qint64, QList<QVariantList>> m_cache;
+    QSet<qint64> m_prefetching;
+    // Medicine ID -> cached invoices mentioning it, so invalidation never has
+    // to walk (and so re-rank) the cache
+    QHash<int, MedicineLines> m_byMedicine;
+    int m_indexedLinks;
+    // Medicine ID -> its latest change, to vet fetches that started before it
+    QHash<int, MedicineChange> m_changes;
+    int m_generation;   // bumped per change set; fetches remember the value they started at
+    int m_clearedAt;    // fetches started before this are not stored
+};
+
+#endif // INVOICEDETAILSCACHE_H
@@ -0,0 +1,93 @@
+#include "invoicelistmodel.h"
+#include "money.h"
+
+InvoiceListModel::InvoiceListModel(AsyncDatabase *database, QObject *parent)
+    : QAbstractTableModel(parent), m_database(database), m_fetching(false), m_atEnd(false), m_generation(0)
+{
+}
+
+int InvoiceListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int InvoiceListModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant InvoiceListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) return QVariant();
+    const InvoiceSummary& invoice = m_rows.at(index.row());
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case IdColumn: return invoice.id;
+        case DateColumn: return invoice.saleDate;
+        case TotalColumn: return Money::format(invoice.totalCents);
+        }
+    } else if (role == Qt::TextAlignmentRole && index.column() == TotalColumn) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    return QVariant();
+}
+
+QVariant InvoiceListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    static const QStringList headers = {"ID", "Date of Sale", "Total Amount"};
+    if (role == Qt::DisplayRole && orientation == Qt::Horizontal && section >= 0 && section < headers.size()) {
+        return headers.at(section);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool InvoiceListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_atEnd && !m_fetching && m_database;
+}
+
+void InvoiceListModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) return;
+
+    m_fetching = true;
+    const InvoiceSummary after = m_rows.isEmpty() ? InvoiceSummary() : m_rows.last();
+    const int generation = m_generation;
+    m_database->getInvoicePage(m_filter, after, PageSize, "invoiceList/page")
+        .then(this, [this, generation](const QList<InvoiceSummary>& page) {
+            if (generation != m_generation) return;
+            m_fetching = false;
+            m_atEnd = page.size() < PageSize;
+            if (page.isEmpty()) return;
+
+            const int first = m_rows.size();
+            beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+            m_rows.append(page);
+            endInsertRows();
+            emit pageLoaded(first, page.size());
+        });
+}
+
+void InvoiceListModel::refresh()
+{
+    beginResetModel();
+    m_rows.clear();
+    m_rows.squeeze();
+    m_fetching = false;
+    m_atEnd = false;
+    ++m_generation;
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+void InvoiceListModel::setFilter(const InvoiceFilter& filter)
+{
+    m_filter = filter;
+    refresh();
+}
+
+qint64 InvoiceListModel::invoiceId(int row) const
+{
+    return row >= 0 && row < m_rows.size() ? m_rows.at(row).id : -1;
+}
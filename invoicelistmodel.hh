@@ -0,0 +1,58 @@
+#ifndef INVOICELISTMODEL_H
+#define INVOICELISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "asyncdatabase.h"
+
+// Newest-first list of invoices, loaded a page at a time as the view scrolls.
+// Pages are keyed on the last row seen rather than an OFFSET, so opening the
+// list and every later page cost the same however many invoices exist.
+// Pages are fetched on the database worker thread.
+class InvoiceListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        IdColumn = 0,
+        DateColumn,
+        TotalColumn,
+        ColumnCount
+    };
+
+    static constexpr int PageSize = 200;
+
+    explicit InvoiceListModel(AsyncDatabase *database, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // Drops the loaded rows and starts again from the newest invoice
+    void refresh();
+    // Shows only matching invoices (refreshes)
+    void setFilter(const InvoiceFilter& filter);
+    const InvoiceFilter& filter() const { return m_filter; }
+
+    // Invoice ID shown in a row, or -1
+    qint64 invoiceId(int row) const;
+
+signals:
+    // Rows [firstRow, firstRow + count) have just been appended
+    void pageLoaded(int firstRow, int count);
+
+private:
+    AsyncDatabase *m_database;
+    InvoiceFilter m_filter;
+    QVector<InvoiceSummary> m_rows;
+    bool m_fetching;
+    bool m_atEnd;
+    int m_generation;  // bumped by refresh() so late pages from before it are dropped
+};
+
+#endif // INVOICELISTMODEL_H
@@ -1,11 +1,43 @@
 #include "mainwindow.h"
+#include "databasemanager.h"
+#include "metrics.h"
+#include "tracing.h"
 #include <QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
-    MainWindow w;
-    w.show();
-    return a.exec();
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption rebuildRollupsOption("rebuild-rollups", "Recompute the sales rollup tables from all invoices and exit.");
+    QCommandLineOption traceOption("trace", "Record a Chrome trace-event file (also MEDICARE_TRACE=<file>).", "file");
+    QCommandLineOption metricsOption("dump-metrics", "Write the latency and counter metrics to a JSON file on exit.", "file");
+    parser.addOptions({rebuildRollupsOption, traceOption, metricsOption});
+    parser.process(a);
+
+    const QString tracePath = parser.isSet(traceOption) ? parser.value(traceOption) : qEnvironmentVariable("MEDICARE_TRACE");
+    if (!tracePath.isEmpty()) Tracing::start(tracePath);
+
+    if (parser.isSet(rebuildRollupsOption)) {
+        bool ok = false;
+        {
+            DatabaseManager db;
+            ok = db.initDatabase() && db.rebuildSalesRollups();
+        }
+        Tracing::stop();
+        return ok ? 0 : 1;
+    }
+
+    int result = 0;
+    {
+        MainWindow w;
+        w.show();
+        result = a.exec();
+    }
+    // After the window and its worker threads are gone, so their spans are complete
+    Tracing::stop();
+    if (parser.isSet(metricsOption)) Metrics::dump(parser.value(metricsOption));
+    return result;
 }
@@ -1,17 +1,30 @@
 #include "mainwindow.h"
 #include "addmedicinedialog.h"
 #include "saleshistorydialog.h"
+#include "invoicedetailscache.h"
+#include "inventorykpis.h"
+#include "catalogimporter.h"
+#include "goodsreceiptdialog.h"
+#include "dataexporter.h"
+#include "stocktablemodel.h"
+#include "copilotcache.h"
+#include "diagnosticsdialog.h"
+#include "metrics.h"
+#include "money.h"
+#include "tracing.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
 #include <QFrame>
 #include <QGraphicsDropShadowEffect>
-#include <QTableWidget>
+#include <QTableView>
 #include <QHeaderView>
 #include <QListWidget>
 #include <QLabel>
 #include <QLineEdit>
 #include <QInputDialog>
+#include <QFileDialog>
+#include <QProgressDialog>
 #include <QMessageBox>
 #include <QMenu>
 #include <QAction>
@@ -22,6 +35,21 @@
 #include <QDebug>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QSet>
+#include <QDir>
+#include <QFileInfo>
+#include <QShortcut>
+
+namespace {
+// Everything the stock grid needs, built on the database worker thread
+struct StockSnapshot
+{
+    StockStore store;
+    StockSearchIndex searchIndex;
+    FuzzyMedicineLookup fuzzyLookup;
+    MedicineRetrieval retrieval;
+};
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -33,11 +61,19 @@ MainWindow::MainWindow(QWidget *parent)
     // Apply the modern stylesheet directly
     this->setStyleSheet(getModernStyleSheet());
 
-    // Initialize Backend
-    m_dbManager = new DatabaseManager();
-    if (!m_dbManager->initDatabase()) {
-        QMessageBox::critical(this, "Database Error", "Failed to initialize the database.");
-    }
+    // Initialize Backend. The worker opens the database and runs the schema
+    // migrations; every other component opens the same file on its own connection.
+    const QString databasePath = DatabaseManager::defaultDatabasePath();
+    m_asyncDb = new AsyncDatabase(databasePath, this);
+    m_asyncDb->opened().then(this, [this](bool ok) {
+        if (!ok) QMessageBox::critical(this, "Database Error", "Failed to initialize the database.");
+    });
+    m_invoiceDetailsCache = new InvoiceDetailsCache(m_asyncDb, InvoiceDetailsCache::DefaultCapacity, this);
+    m_kpis = new InventoryKpis(this);
+    m_catalogImporter = new CatalogImporter(databasePath, this);
+    m_dataExporter = new DataExporter(databasePath, this);
+    m_copilotCache = new CopilotCache(QFileInfo(databasePath).dir().filePath("copilot-cache.json"),
+                                      CopilotCache::DefaultTtlSeconds, this);
 
     // Initialize Networking for PharmaCopilot
      m_networkManager = new QNetworkAccessManager(this);
@@ -46,11 +82,21 @@ MainWindow::MainWindow(QWidget *parent)
     // Build the UI and populate it with data
     setupModernUI();
     populateStockTable();
+
+    // After the initial load, only the rows a write touched are refreshed
+    connect(m_asyncDb, &AsyncDatabase::medicinesChanged, this, &MainWindow::onMedicinesChanged);
+    // The expiring window rolls over at midnight without any medicine changing
+    connect(m_kpis, &InventoryKpis::countsChanged, this, &MainWindow::refreshStatsCards);
+    // ... and so do the grid's expiry colours, which must agree with the cards
+    connect(m_kpis, &InventoryKpis::countsChanged, m_stockModel, &StockTableModel::rollDateWindow);
+
+    // Support staff only; deliberately left out of the toolbar
+    QShortcut *diagnosticsShortcut = new QShortcut(QKeySequence("Ctrl+Shift+D"), this);
+    connect(diagnosticsShortcut, &QShortcut::activated, this, &MainWindow::onShowDiagnostics);
 }
 
 MainWindow::~MainWindow()
 {
-    delete m_dbManager;
 }
 
 void MainWindow::setupModernUI()
@@ -71,7 +117,8 @@ void MainWindow::setupModernUI()
     inventoryHeader->setProperty("labelType", "header");
 
     m_searchLineEdit = new QLineEdit();
-    m_searchLineEdit->setPlaceholderText("Search medicines by name...");
+    m_searchLineEdit->setObjectName("stockSearch");
+    m_searchLineEdit->setPlaceholderText("Search medicines by name, batch or ID...");
     connect(m_searchLineEdit, &QLineEdit::textChanged, this, &MainWindow::onSearchQueryChanged);
 
     QHBoxLayout *buttonToolbar = new QHBoxLayout();
@@ -82,10 +129,20 @@ void MainWindow::setupModernUI()
     ModernButton *historyButton = new ModernButton("📊 Sales History");
     connect(historyButton, &QPushButton::clicked, this, &MainWindow::onSalesHistoryClicked);
     buttonToolbar->addWidget(addButton);
+    ModernButton *importButton = new ModernButton("📥 Import Catalog");
+    connect(importButton, &QPushButton::clicked, this, &MainWindow::onImportCatalogClicked);
+    ModernButton *receiveButton = new ModernButton("🚚 Receive Goods");
+    connect(receiveButton, &QPushButton::clicked, this, &MainWindow::onReceiveGoodsClicked);
     buttonToolbar->addWidget(historyButton);
+    buttonToolbar->addWidget(receiveButton);
+    ModernButton *exportButton = new ModernButton("📤 Export Data");
+    connect(exportButton, &QPushButton::clicked, this, &MainWindow::onExportDataClicked);
+    buttonToolbar->addWidget(importButton);
+    buttonToolbar->addWidget(exportButton);
     buttonToolbar->addStretch();
 
-    m_stockTableWidget = new QTableWidget();
+    m_stockTableView = new QTableView();
+    m_stockModel = new StockTableModel(&m_stockStore, this);
     setupModernTable();
 
     QHBoxLayout *statsLayout = new QHBoxLayout();
@@ -101,7 +158,7 @@ void MainWindow::setupModernUI()
     inventoryLayout->addWidget(inventoryHeader);
     inventoryLayout->addWidget(m_searchLineEdit);
     inventoryLayout->addLayout(buttonToolbar);
-    inventoryLayout->addWidget(m_stockTableWidget);
+    inventoryLayout->addWidget(m_stockTableView);
     inventoryLayout->addLayout(statsLayout);
 
     // --- Right Side: POS & AI Assistant ---
@@ -138,18 +195,21 @@ void MainWindow::setupModernUI()
         // Get the name of the medicine from the clicked suggestion item
         QString medicineName = item->text();
 
-        // Loop through the main stock table to find the matching medicine
-        for (int i = 0; i < m_stockTableWidget->rowCount(); ++i) {
-            // Check if the row is visible (not filtered out by search)
-            if (!m_stockTableWidget->isRowHidden(i)) {
-                QTableWidgetItem* tableItem = m_stockTableWidget->item(i, 1); // Column 1 is "Medicine Name"
-                if (tableItem && tableItem->text() == medicineName) {
-                    // We found a match!
-                    // Simulate a double-click on the main table to reuse all existing logic.
-                    onStockTableDoubleClicked(i, 1);
-                    return; // Exit the loop once the item is added
-                }
-            }
+        // Loop through the visible (search-filtered) stock rows to find the matching medicine
+        int row = -1;
+        for (int i = 0; i < m_stockModel->rowCount() && row < 0; ++i) {
+            if (m_stockStore.name(m_stockModel->storeIndex(i)) == medicineName) row = i;
+        }
+        // The model may reword or misspell the name; fall back to the closest fuzzy match
+        if (row < 0) {
+            const auto matches = m_fuzzyLookup.lookup(medicineName, 1);
+            if (!matches.isEmpty()) row = m_stockModel->rowForStoreIndex(matches.first().storeIndex);
+        }
+        if (row >= 0) {
+            // Select it and simulate a double-click to reuse all existing logic.
+            QModelIndex index = m_stockModel->index(row, StockStore::NameColumn);
+            m_stockTableView->setCurrentIndex(index);
+            onStockTableDoubleClicked(index);
         }
     });
     // --- END OF FIX ---
@@ -166,12 +226,12 @@ void MainWindow::setupModernUI()
     ModernButton *clearCartButton = new ModernButton("🗑️ Clear Cart");
     clearCartButton->setButtonType("danger");
     connect(clearCartButton, &QPushButton::clicked, this, &MainWindow::onClearCartClicked);
-    ModernButton *finalizeSaleButton = new ModernButton("💳 Finalize Sale");
-    finalizeSaleButton->setButtonType("primary");
-    finalizeSaleButton->setFixedHeight(50);
-    connect(finalizeSaleButton, &QPushButton::clicked, this, &MainWindow::onFinalizeSaleClicked);
+    m_finalizeSaleButton = new ModernButton("💳 Finalize Sale");
+    m_finalizeSaleButton->setButtonType("primary");
+    m_finalizeSaleButton->setFixedHeight(50);
+    connect(m_finalizeSaleButton, &QPushButton::clicked, this, &MainWindow::onFinalizeSaleClicked);
     cartButtonsLayout->addWidget(clearCartButton);
-    cartButtonsLayout->addWidget(finalizeSaleButton, 2);
+    cartButtonsLayout->addWidget(m_finalizeSaleButton, 2);
 
     // Assemble Right Layout
     rightLayout->addWidget(copilotHeader);
@@ -222,7 +282,7 @@ QString MainWindow::getModernStyleSheet()
         QLineEdit:focus {
             border: 1px solid #667eea;
         }
-        QTableWidget {
+        QTableView {
             background-color: #2d3748;
             border: none;
             border-radius: 8px;
@@ -272,111 +332,117 @@ QFrame* MainWindow::createModernFrame()
 
 void MainWindow::setupModernTable()
 {
-    m_stockTableWidget->setColumnCount(6);
-    m_stockTableWidget->setHorizontalHeaderLabels({"ID", "Medicine Name", "Batch", "Expiry", "Qty", "Price"});
-
-    // --- THIS IS THE CORRECT AND FINAL FIX ---
-    // We explicitly tell the table to use a different trigger for editing,
-    // which frees up the DoubleClick action to emit its signal properly.
-    m_stockTableWidget->setEditTriggers(QAbstractItemView::SelectedClicked);
-    // -----------------------------------------
-
-    m_stockTableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-    m_stockTableWidget->setSelectionMode(QAbstractItemView::SingleSelection);
-    m_stockTableWidget->setAlternatingRowColors(false); // This is often handled by modern stylesheets
-    m_stockTableWidget->verticalHeader()->setVisible(false);
-    m_stockTableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    m_stockTableWidget->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(m_stockTableWidget, &QTableWidget::customContextMenuRequested, this, &MainWindow::showTableContextMenu);
-
-    // This connect statement is and always has been correct.
-    // It will now work because the event is no longer blocked.
-    connect(m_stockTableWidget, &QTableWidget::cellDoubleClicked, this, &MainWindow::onStockTableDoubleClicked);
+    m_stockTableView->setModel(m_stockModel);
+    // Row colours are computed while painting instead of stored per cell
+    m_stockTableView->setItemDelegate(new StockRowDelegate(m_stockTableView));
+
+    // The model is read-only, so double-click is free to emit its signal.
+    m_stockTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    m_stockTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_stockTableView->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_stockTableView->setAlternatingRowColors(false); // This is often handled by modern stylesheets
+    m_stockTableView->verticalHeader()->setVisible(false);
+    // Fixed row heights let the view map scroll offsets to rows without measuring them
+    m_stockTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_stockTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_stockTableView->horizontalHeader()->setSortIndicator(StockStore::IdColumn, Qt::AscendingOrder);
+    m_stockTableView->setSortingEnabled(true);
+    m_stockTableView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(m_stockTableView, &QTableView::customContextMenuRequested, this, &MainWindow::showTableContextMenu);
+    connect(m_stockTableView, &QTableView::doubleClicked, this, &MainWindow::onStockTableDoubleClicked);
 }
 
-void MainWindow::updateStockStats()
+int MainWindow::selectedStoreIndex() const
 {
-    if (!m_totalStatsCard) return;
-    int totalMedicines = 0, lowStock = 0, expiringSoon = 0;
-    int lowStockThreshold = 10;
-    QDate today = QDate::currentDate();
-    for (int i = 0; i < m_stockTableWidget->rowCount(); ++i) {
-        if (!m_stockTableWidget->isRowHidden(i)) {
-            totalMedicines++;
-            int quantity = m_stockTableWidget->item(i, 4)->text().toInt();
-            QDate expiryDate = QDate::fromString(m_stockTableWidget->item(i, 3)->text(), "yyyy-MM-dd");
-            if (quantity < lowStockThreshold) lowStock++;
-            if (expiryDate >= today && expiryDate < today.addMonths(3)) expiringSoon++;
-        }
-    }
-    m_totalStatsCard->updateValue(QString::number(totalMedicines));
-    m_lowStockCard->updateValue(QString::number(lowStock));
-    m_expiringCard->updateValue(QString::number(expiringSoon));
+    QModelIndex current = m_stockTableView->currentIndex();
+    if (!current.isValid()) return -1;
+    return m_stockModel->storeIndex(current.row());
+}
+
+void MainWindow::refreshStatsCards()
+{
+    TRACE_SCOPE("ui", "MainWindow::refreshStatsCards");
+    LATENCY_SCOPE("ui.refreshStatsCards");
+    m_totalStatsCard->updateValue(QString::number(m_kpis->totalMedicines()));
+    m_lowStockCard->updateValue(QString::number(m_kpis->lowStockCount()));
+    m_expiringCard->updateValue(QString::number(m_kpis->expiringCount()));
 }
 
 void MainWindow::populateStockTable()
 {
-    if (!m_stockTableWidget) return;
-    // Disconnecting during population can prevent unwanted signals and speed up large updates
-    m_stockTableWidget->setSortingEnabled(false);
-    m_stockTableWidget->clearContents();
-    m_stockTableWidget->setRowCount(0);
-
-    QList<QVariantList> medicines = m_dbManager->getAllMedicines();
-    m_stockTableWidget->setRowCount(medicines.count());
-
-    int lowStockThreshold = 10;
-    QDate today = QDate::currentDate();
-
-    for (int i = 0; i < medicines.count(); ++i) {
-        const QVariantList& medicine = medicines.at(i);
-
-        // --- Create items for each column ---
-        QTableWidgetItem *idItem = new QTableWidgetItem(medicine[0].toString());
-        QTableWidgetItem *nameItem = new QTableWidgetItem(medicine[1].toString());
-        QTableWidgetItem *batchItem = new QTableWidgetItem(medicine[2].toString());
-        QTableWidgetItem *expiryItem = new QTableWidgetItem(medicine[3].toString());
-        QTableWidgetItem *quantityItem = new QTableWidgetItem(medicine[4].toString());
-        QTableWidgetItem *priceItem = new QTableWidgetItem(QString::number(medicine[5].toDouble(), 'f', 2));
-
-        // --- THIS IS THE FIX ---
-        // Create a list of the new items to easily loop through them
-        QList<QTableWidgetItem*> items = {idItem, nameItem, batchItem, expiryItem, quantityItem, priceItem};
-        for (QTableWidgetItem *item : items) {
-            // Get the default flags and remove the "ItemIsEditable" flag
-            Qt::ItemFlags flags = item->flags();
-            flags &= ~Qt::ItemIsEditable; // This is a bitwise operation to switch off the editable flag
-            item->setFlags(flags);
+    TRACE_SCOPE("ui", "MainWindow::populateStockTable");
+    if (!m_stockModel) return;
+
+    // Reading and indexing the whole inventory happens off the UI thread. Writes
+    // queue behind this on the same worker, so their change sets arrive after it.
+    m_asyncDb->run([](DatabaseManager& db) {
+        TRACE_SCOPE("ui", "MainWindow::populateStockTable/build");
+        LATENCY_SCOPE("ui.populateStockTable.build");
+        StockSnapshot snapshot;
+        db.loadMedicines(snapshot.store);
+        snapshot.searchIndex.rebuild(snapshot.store);
+        snapshot.fuzzyLookup.rebuild(snapshot.store);
+        snapshot.retrieval.rebuild(snapshot.store);
+        return snapshot;
+    }, "stockGrid/load").then(this, [this](const StockSnapshot& snapshot) {
+        TRACE_SCOPE("ui", "MainWindow::populateStockTable/apply");
+        LATENCY_SCOPE("ui.populateStockTable.apply");
+        m_stockStore = snapshot.store;
+        m_searchIndex = snapshot.searchIndex;
+        m_fuzzyLookup = snapshot.fuzzyLookup;
+        m_retrieval = snapshot.retrieval;
+        m_stockModel->reload();
+        // Reloading clears the model's filter, so re-apply the current search
+        if (!m_searchLineEdit->text().isEmpty()) {
+            onSearchQueryChanged(m_searchLineEdit->text());
         }
-        // ----------------------
-
-        // Now set the items in the table
-        m_stockTableWidget->setItem(i, 0, idItem);
-        m_stockTableWidget->setItem(i, 1, nameItem);
-        m_stockTableWidget->setItem(i, 2, batchItem);
-        m_stockTableWidget->setItem(i, 3, expiryItem);
-        m_stockTableWidget->setItem(i, 4, quantityItem);
-        m_stockTableWidget->setItem(i, 5, priceItem);
-
-        // --- Visual Alerts (Your existing code is good) ---
-        bool isLowStock = medicine[4].toInt() < lowStockThreshold;
-        QDate expiryDate = QDate::fromString(medicine[3].toString(), "yyyy-MM-dd");
-        bool isExpired = expiryDate < today;
-        bool isExpiringSoon = expiryDate >= today && expiryDate < today.addMonths(3);
-
-        QColor rowColor(0,0,0,0); // Transparent
-        if (isExpired) rowColor = QColor(229, 62, 62, 50);
-        else if (isLowStock) rowColor = QColor(246, 173, 85, 50);
-        else if (isExpiringSoon) rowColor = QColor(236, 201, 75, 50);
-
-        if (rowColor.alpha() > 0) {
-            for (int j = 0; j < m_stockTableWidget->columnCount(); ++j) {
-                m_stockTableWidget->item(i, j)->setBackground(rowColor);
+        m_kpis->reset(m_stockStore);
+        refreshStatsCards();
+    });
+}
+
+void MainWindow::onMedicinesChanged(const MedicineChangeSet& changes)
+{
+    TRACE_SCOPE("ui", "MainWindow::onMedicinesChanged");
+    LATENCY_SCOPE("ui.onMedicinesChanged");
+    for (int id : changes.deleted) {
+        int index = m_stockStore.indexOfId(id);
+        if (index < 0) continue;
+        m_kpis->remove(index);
+        m_stockModel->removeStoreIndex(index);
+        m_searchIndex.remove(index);
+        m_fuzzyLookup.remove(index);
+        m_retrieval.remove(index);
+        m_stockStore.remove(index);
+    }
+
+    const QList<int> reloadIds = changes.inserted + changes.updated;
+    if (!reloadIds.isEmpty()) {
+        const StockStore& fresh = changes.rows;
+
+        // One row at a time: the model finds a row by its old sort key, so it
+        // must see each change before the next row is overwritten
+        const QString searchText = m_searchLineEdit->text();
+        for (int i = 0; i < fresh.size(); ++i) {
+            const bool known = m_stockStore.indexOfId(fresh.id(i)) >= 0;
+            if (known) m_stockModel->aboutToUpdateStoreIndex(m_stockStore.indexOfId(fresh.id(i)));
+            const int index = m_stockStore.upsert(fresh.id(i), fresh.name(i), fresh.batchNumber(i),
+                                                  fresh.expiryDay(i), fresh.quantity(i), fresh.priceCents(i));
+            m_searchIndex.update(m_stockStore, index);
+            m_fuzzyLookup.update(m_stockStore, index);
+            m_retrieval.update(m_stockStore, index);
+            bool match = searchText.isEmpty() || m_searchIndex.matches(index, searchText);
+            if (known) {
+                m_stockModel->updateStoreIndex(index, match);
+            } else {
+                m_stockModel->insertStoreIndex(index, match);
             }
+            m_kpis->update(m_stockStore, index);
         }
     }
-    m_stockTableWidget->setSortingEnabled(true);
-    updateStockStats();
+
+    refreshStatsCards();
 }
 
 void MainWindow::onClearCartClicked()
@@ -386,6 +452,7 @@ void MainWindow::onClearCartClicked()
     if (reply == QMessageBox::Yes) {
         m_cartListWidget->clear();
         updateTotalAmount();
+        m_asyncDb->releaseAllHolds();
     }
 }
 
@@ -398,28 +465,28 @@ void MainWindow::onAddMedicineClicked()
             QMessageBox::warning(this, "Input Error", "Medicine name cannot be empty.");
             return;
         }
-        if (m_dbManager->addMedicine(name, dialog.batchNumber(), dialog.expiryDate(), dialog.quantity(), dialog.price())) {
-            QMessageBox::information(this, "Success", "Medicine added successfully.");
-            populateStockTable();
-        } else {
-            QMessageBox::critical(this, "Database Error", "Failed to add medicine.");
-        }
+        m_asyncDb->addMedicine(name, dialog.batchNumber(), dialog.expiryDate(), dialog.quantity(), dialog.price())
+            .then(this, [this](bool success) {
+                if (success) {
+                    QMessageBox::information(this, "Success", "Medicine added successfully.");
+                } else {
+                    QMessageBox::critical(this, "Database Error", "Failed to add medicine.");
+                }
+            });
     }
 }
 
 void MainWindow::onEditMedicineClicked()
 {
-    int row = m_stockTableWidget->currentRow();
-    if (row < 0) {
+    int index = selectedStoreIndex();
+    if (index < 0) {
         QMessageBox::warning(this, "No Selection", "Please select a medicine to edit.");
         return;
     }
 
-    QVariantList data;
-    for(int i = 0; i < m_stockTableWidget->columnCount(); ++i) {
-        data << m_stockTableWidget->item(row, i)->data(Qt::DisplayRole);
-    }
+    QVariantList data = m_stockStore.rowData(index);
     int medicineId = data[0].toInt();
+    int readQty = m_stockStore.quantity(index);
 
     AddMedicineDialog dialog(data, this);
     if (dialog.exec() == QDialog::Accepted) {
@@ -432,38 +499,44 @@ void MainWindow::onEditMedicineClicked()
         double price = dialog.price();
         // ------------------------------------
 
-        if (m_dbManager->updateMedicine(medicineId, name, batch, expiry, qty, price)) {
-            QMessageBox::information(this, "Success", "Medicine updated successfully.");
-            populateStockTable();
-        } else {
-            QMessageBox::critical(this, "Database Error", "Failed to update medicine.");
-        }
+        m_asyncDb->updateMedicine(medicineId, name, batch, expiry, readQty, qty, price).then(this, [this](bool success) {
+            if (success) {
+                QMessageBox::information(this, "Success", "Medicine updated successfully.");
+            } else {
+                QMessageBox::critical(this, "Database Error",
+                                      "Failed to update medicine. Other counters may be holding the stock you removed.");
+            }
+        });
     }
 }
 
-void MainWindow::updateTotalAmount()
+qint64 MainWindow::cartTotalCents(const QListWidget *cart)
 {
-    double total = 0.0;
-    for (int i = 0; i < m_cartListWidget->count(); ++i) {
-        QListWidgetItem *item = m_cartListWidget->item(i);
-        total += item->data(Qt::UserRole + 1).toDouble();
+    qint64 totalCents = 0;
+    for (int i = 0; i < cart->count(); ++i) {
+        totalCents += cart->item(i)->data(Qt::UserRole + 1).toLongLong();
     }
-    m_totalAmountLabel->setText(QString("Total: $ %1").arg(total, 0, 'f', 2));
+    return totalCents;
 }
 
-void MainWindow::onStockTableDoubleClicked(int row, int column)
+void MainWindow::updateTotalAmount()
+{
+    m_totalAmountLabel->setText(QString("Total: $ %1").arg(Money::format(cartTotalCents(m_cartListWidget))));
+}
+
+void MainWindow::onStockTableDoubleClicked(const QModelIndex &index)
 {
-    qDebug() << "onStockTableDoubleClicked triggered for row:" << row;
+    int storeIndex = m_stockModel->storeIndex(index.row());
+    if (storeIndex < 0) return;
 
     // --- Step 1: Get all necessary data from the selected row ---
-    int medicineId = m_stockTableWidget->item(row, 0)->text().toInt();
-    QString name = m_stockTableWidget->item(row, 1)->text();
-    QString expiryDateString = m_stockTableWidget->item(row, 3)->text(); // Get the expiry date string
-    int availableQty = m_stockTableWidget->item(row, 4)->text().toInt();
-    double price = m_stockTableWidget->item(row, 5)->text().toDouble();
+    int medicineId = m_stockStore.id(storeIndex);
+    QString name = m_stockStore.name(storeIndex);
+    int availableQty = m_stockStore.quantity(storeIndex);
+    qint64 priceCents = m_stockStore.priceCents(storeIndex);
 
     // --- Step 2: Perform the critical expiry check FIRST ---
-    QDate expiryDate = QDate::fromString(expiryDateString, "yyyy-MM-dd");
+    QDate expiryDate = m_stockStore.expiryDate(storeIndex);
     if (expiryDate < QDate::currentDate()) {
         QMessageBox::critical(this, "Expired Medicine Alert",
                               QString("Cannot sell '%1'.\n\nReason: Medicine expired on %2.")
@@ -497,16 +570,43 @@ void MainWindow::onStockTableDoubleClicked(int row, int column)
     int qtyToSell = QInputDialog::getInt(this, "Select Quantity",
                                          QString("Enter quantity for %1:").arg(name), 1, 1, availableQty, 1, &ok);
 
-    if (ok) {
-        double subtotal = qtyToSell * price;
-        QString cartText = QString("💊 %1x %2 @ $%3 = $%4")
-                               .arg(qtyToSell).arg(name).arg(price, 0, 'f', 2).arg(subtotal, 0, 'f', 2);
-        QListWidgetItem *cartItem = new QListWidgetItem(cartText, m_cartListWidget);
-        cartItem->setData(Qt::UserRole, medicineId);
-        cartItem->setData(Qt::UserRole + 1, subtotal);
-        cartItem->setData(Qt::UserRole + 2, qtyToSell);
-        updateTotalAmount();
+    if (!ok) return;
+
+    // The grid may be stale and other counters sell the same stock, so the
+    // line is only added once the database has reserved it for this terminal
+    int alreadyInCart = 0;
+    for (int i = 0; i < m_cartListWidget->count(); ++i) {
+        QListWidgetItem *item = m_cartListWidget->item(i);
+        if (item->data(Qt::UserRole).toInt() == medicineId) alreadyInCart += item->data(Qt::UserRole + 2).toInt();
     }
+
+    m_asyncDb->holdStock(medicineId, alreadyInCart + qtyToSell).then(this, [=](const StockHold& hold) {
+        switch (hold.status) {
+        case StockHold::Held: {
+            qint64 subtotalCents = qtyToSell * priceCents;
+            QString cartText = QString("💊 %1x %2 @ $%3 = $%4")
+                                   .arg(qtyToSell).arg(name, Money::format(priceCents), Money::format(subtotalCents));
+            QListWidgetItem *cartItem = new QListWidgetItem(cartText, m_cartListWidget);
+            cartItem->setData(Qt::UserRole, medicineId);
+            cartItem->setData(Qt::UserRole + 1, subtotalCents); // cents
+            cartItem->setData(Qt::UserRole + 2, qtyToSell);
+            updateTotalAmount();
+            break;
+        }
+        case StockHold::Insufficient:
+            QMessageBox::warning(this, "Stock Reserved Elsewhere",
+                                 QString("Only %1 more unit(s) of '%2' can be sold from this counter.\n"
+                                         "The rest is sold or held in another counter's cart.")
+                                     .arg(qMax(0, hold.available - alreadyInCart)).arg(name));
+            break;
+        case StockHold::NotFound:
+            QMessageBox::warning(this, "Medicine Removed", QString("'%1' is no longer in the inventory.").arg(name));
+            break;
+        case StockHold::Failed:
+            QMessageBox::critical(this, "Database Error", "Failed to reserve stock for this sale.");
+            break;
+        }
+    });
 }
 void MainWindow::onFinalizeSaleClicked()
 {
@@ -516,55 +616,174 @@ void MainWindow::onFinalizeSaleClicked()
     }
 
     QList<QPair<int, int>> cartItems;
-    double totalAmount = 0.0;
     for (int i = 0; i < m_cartListWidget->count(); ++i) {
         QListWidgetItem* item = m_cartListWidget->item(i);
         cartItems.append({item->data(Qt::UserRole).toInt(), item->data(Qt::UserRole + 2).toInt()});
-        totalAmount += item->data(Qt::UserRole + 1).toDouble();
     }
 
-    qint64 invoiceId = m_dbManager->createInvoice(totalAmount, cartItems);
-    if (invoiceId != -1) {
-        QMessageBox::information(this, "Success", QString("Sale finalized successfully!\nInvoice ID: %1").arg(invoiceId));
-        m_cartListWidget->clear();
-        updateTotalAmount();
-        populateStockTable();
-    } else {
-        QMessageBox::critical(this, "Database Error", "Failed to finalize the sale.");
-    }
+    // The cart stays locked until the worker has committed or rejected the sale
+    m_finalizeSaleButton->setEnabled(false);
+    m_cartListWidget->setEnabled(false);
+    QElapsedTimer checkoutTimer;
+    checkoutTimer.start();
+    m_asyncDb->createInvoice(cartItems).then(this, [this, checkoutTimer](const CheckoutResult& result) {
+        // From the click to the commit or refusal, including the wait for the worker
+        static LatencyHistogram *const checkoutLatency = Metrics::histogram("checkout.commit");
+        checkoutLatency->record(checkoutTimer.nsecsElapsed() / 1000);
+        Metrics::counter(result.invoiceId != -1 ? "checkout.completed"
+                         : result.shortMedicineIds.isEmpty() ? "checkout.failed" : "checkout.short")->add();
+        m_finalizeSaleButton->setEnabled(true);
+        m_cartListWidget->setEnabled(true);
+        if (result.invoiceId != -1) {
+            QMessageBox::information(this, "Success", QString("Sale finalized successfully!\nInvoice ID: %1").arg(result.invoiceId));
+            m_cartListWidget->clear();
+            updateTotalAmount();
+        } else if (!result.shortMedicineIds.isEmpty()) {
+            // Only possible once a hold has expired; the cart is kept so it can be adjusted
+            QStringList names;
+            for (int id : result.shortMedicineIds) {
+                int index = m_stockStore.indexOfId(id);
+                names.append(index >= 0 ? m_stockStore.name(index) : QString("ID %1").arg(id));
+            }
+            QMessageBox::warning(this, "Not Enough Stock",
+                                 QString("Nothing was sold. Another counter has taken stock of:\n%1").arg(names.join("\n")));
+        } else {
+            QMessageBox::critical(this, "Database Error", "Failed to finalize the sale.");
+        }
+    });
 }
 
 void MainWindow::onSearchQueryChanged(const QString& text)
 {
-    for (int i = 0; i < m_stockTableWidget->rowCount(); ++i) {
-        QTableWidgetItem *item = m_stockTableWidget->item(i, 1);
-        if (item) {
-            bool match = item->text().contains(text, Qt::CaseInsensitive);
-            m_stockTableWidget->setRowHidden(i, !match);
+    TRACE_SCOPE("ui", "MainWindow::onSearchQueryChanged");
+    LATENCY_SCOPE("ui.search");
+    // Keep the selected medicine selected if it survives the new filter
+    int selected = selectedStoreIndex();
+
+    if (text.isEmpty()) {
+        m_stockModel->clearFilter();
+    } else {
+        QVector<int> matches = m_searchIndex.search(text);
+        if (matches.isEmpty()) {
+            // Nothing contains the text as typed; show the closest spellings instead
+            const int fuzzyResultLimit = 25;
+            for (const FuzzyMedicineLookup::Match& match : m_fuzzyLookup.lookup(text, fuzzyResultLimit)) {
+                matches.append(match.storeIndex);
+            }
         }
+        m_stockModel->setFilter(matches);
+    }
+
+    int row = m_stockModel->rowForStoreIndex(selected);
+    if (row >= 0) {
+        m_stockTableView->selectRow(row);
     }
 }
 
 void MainWindow::onSalesHistoryClicked()
 {
     // Create an instance of our SalesHistoryDialog
-    SalesHistoryDialog dialog(m_dbManager, this);
+    SalesHistoryDialog dialog(m_asyncDb, m_invoiceDetailsCache, &m_stockStore, &m_searchIndex, this);
 
     // Show the dialog modally (it will block the main window until closed)
     dialog.exec();
 }
 
+void MainWindow::onReceiveGoodsClicked()
+{
+    // Booking the note emits one change set, so the grid updates once for all lines
+    GoodsReceiptDialog dialog(m_asyncDb, &m_stockStore, this);
+    dialog.exec();
+}
+
+void MainWindow::onExportDataClicked()
+{
+    if (m_dataExporter->isRunning()) return;
+    const QString directory = QFileDialog::getExistingDirectory(this, "Export Sales and Stock To");
+    if (directory.isEmpty()) return;
+
+    const QStringList formats = {"CSV (spreadsheets)", "Columnar .mcol (reporting tools)"};
+    bool ok = false;
+    const QString format = QInputDialog::getItem(this, "Export Data", "Format:", formats, 0, false, &ok);
+    if (!ok) return;
+
+    // The row total is not known up front, so the dialog only shows activity
+    QProgressDialog *progressDialog = new QProgressDialog("Exporting...", "Cancel", 0, 0, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->setAutoClose(false);
+    connect(progressDialog, &QProgressDialog::canceled, m_dataExporter, &DataExporter::cancel);
+    connect(m_dataExporter, &DataExporter::progress, progressDialog, [progressDialog](const QString& fileName, qint64 rows) {
+        progressDialog->setLabelText(QString("Writing %1: %2 rows").arg(fileName).arg(rows));
+    });
+    connect(m_dataExporter, &DataExporter::finished, progressDialog,
+            [this, progressDialog](bool ok, const QStringList& files, const QString& error) {
+        progressDialog->deleteLater();
+        if (ok) QMessageBox::information(this, "Export Complete", "Wrote:\n" + files.join('\n'));
+        else QMessageBox::warning(this, "Export Stopped", error + (files.isEmpty() ? QString() : "\n\nCompleted:\n" + files.join('\n')));
+    });
+
+    m_dataExporter->start(directory, DataExporter::AllDatasets,
+                          format == formats.first() ? DataExporter::Csv : DataExporter::Columnar);
+}
+
+void MainWindow::onImportCatalogClicked()
+{
+    if (m_catalogImporter->isRunning()) return;
+    const QString path = QFileDialog::getOpenFileName(this, "Import Supplier Catalog", QString(),
+                                                      "CSV files (*.csv);;All files (*)");
+    if (path.isEmpty()) return;
+
+    const QStringList choices = {"Update its name, expiry and price (stock is kept)", "Keep the existing medicine"};
+    bool ok = false;
+    const QString choice = QInputDialog::getItem(this, "Import Supplier Catalog",
+                                                 "When a batch number is already in stock:", choices, 0, false, &ok);
+    if (!ok) return;
+    m_catalogImporter->setDuplicatePolicy(choice == choices.first() ? DatabaseManager::UpdateDuplicates
+                                                                    : DatabaseManager::SkipDuplicates);
+
+    // Progress is shown in permille of the file so large catalogs fit an int range
+    QProgressDialog *progressDialog = new QProgressDialog("Importing catalog...", "Cancel", 0, 1000, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->setAutoClose(false);
+    connect(progressDialog, &QProgressDialog::canceled, m_catalogImporter, &CatalogImporter::cancel);
+    connect(m_catalogImporter, &CatalogImporter::progress, progressDialog, [progressDialog](const CatalogImportProgress& progress) {
+        progressDialog->setValue(progress.totalBytes > 0 ? int(progress.bytesRead * 1000 / progress.totalBytes) : 0);
+        progressDialog->setLabelText(QString("%1 rows read, %2 added, %3 updated\n%4 rows/s")
+                                         .arg(progress.rowsRead).arg(progress.inserted).arg(progress.updated)
+                                         .arg(qRound(progress.rowsPerSecond())));
+    });
+    connect(m_catalogImporter, &CatalogImporter::finished, progressDialog,
+            [this, progressDialog](bool ok, const CatalogImportProgress& summary, const QStringList& errors) {
+        progressDialog->deleteLater();
+        // Imports bypass the per-row change notifications, so reload the grid
+        // once and drop invoice lines that may show a renamed medicine
+        populateStockTable();
+        m_invoiceDetailsCache->clear();
+
+        QString message = QString("%1 rows in %2 s: %3 added, %4 updated, %5 skipped, %6 rejected.")
+                              .arg(summary.rowsRead).arg(summary.elapsedMs / 1000.0, 0, 'f', 1)
+                              .arg(summary.inserted).arg(summary.updated).arg(summary.skipped).arg(summary.rejected);
+        if (!errors.isEmpty()) message += "\n\n" + errors.mid(0, 10).join('\n');
+        if (ok) QMessageBox::information(this, "Import Complete", message);
+        else QMessageBox::warning(this, "Import Stopped", message);
+    });
+
+    m_catalogImporter->start(path);
+}
+
 
 // --- ADD THIS ENTIRE BLOCK OF MISSING FUNCTIONS TO THE END OF mainwindow.cpp ---
 
 void MainWindow::showTableContextMenu(const QPoint &pos)
 {
     // Ensure we have a valid item at the clicked position
-    QTableWidgetItem* item = m_stockTableWidget->itemAt(pos);
-    if (!item) return;
+    QModelIndex index = m_stockTableView->indexAt(pos);
+    if (!index.isValid()) return;
 
     // Map the local position to a global position for the menu
-    QPoint globalPos = m_stockTableWidget->mapToGlobal(pos);
+    QPoint globalPos = m_stockTableView->viewport()->mapToGlobal(pos);
 
     QMenu contextMenu;
     // Apply a modern style to the context menu if you have one
@@ -590,39 +809,40 @@ void MainWindow::showTableContextMenu(const QPoint &pos)
 
 void MainWindow::onDeleteMedicineClicked()
 {
-    int row = m_stockTableWidget->currentRow();
-    if (row < 0) {
+    int index = selectedStoreIndex();
+    if (index < 0) {
         QMessageBox::warning(this, "No Selection", "Please select a medicine to delete.");
         return;
     }
 
-    QString medicineName = m_stockTableWidget->item(row, 1)->text();
-    int medicineId = m_stockTableWidget->item(row, 0)->text().toInt();
+    QString medicineName = m_stockStore.name(index);
+    int medicineId = m_stockStore.id(index);
 
     auto reply = QMessageBox::question(this, "Confirm Deletion",
                                        QString("Are you sure you want to permanently delete '%1'?").arg(medicineName),
                                        QMessageBox::Yes | QMessageBox::No);
 
     if (reply == QMessageBox::Yes) {
-        if (m_dbManager->deleteMedicine(medicineId)) { // You will need to add deleteMedicine to DatabaseManager
-            QMessageBox::information(this, "Success", "Medicine deleted.");
-            populateStockTable();
-        } else {
-            QMessageBox::critical(this, "Database Error", "Failed to delete medicine. It may be part of an existing invoice.");
-        }
+        m_asyncDb->deleteMedicine(medicineId).then(this, [this](bool success) {
+            if (success) {
+                QMessageBox::information(this, "Success", "Medicine deleted.");
+            } else {
+                QMessageBox::critical(this, "Database Error", "Failed to delete medicine. It may be part of an existing invoice.");
+            }
+        });
     }
 }
 
 void MainWindow::onAddStockClicked()
 {
-    int row = m_stockTableWidget->currentRow();
-    if (row < 0) {
+    int index = selectedStoreIndex();
+    if (index < 0) {
         QMessageBox::warning(this, "No Selection", "Please select a medicine to add stock to.");
         return;
     }
 
-    int medicineId = m_stockTableWidget->item(row, 0)->text().toInt();
-    QString medicineName = m_stockTableWidget->item(row, 1)->text();
+    int medicineId = m_stockStore.id(index);
+    QString medicineName = m_stockStore.name(index);
 
     bool ok;
     int qtyToAdd = QInputDialog::getInt(this, "Add Stock",
@@ -630,10 +850,11 @@ void MainWindow::onAddStockClicked()
                                         1, 1, 9999, 1, &ok);
 
     if (ok) {
-        if (m_dbManager->addStock(medicineId, qtyToAdd)) {
-            QMessageBox::information(this, "Success", "Stock updated successfully.");
-            populateStockTable();
-        }
+        m_asyncDb->addStock(medicineId, qtyToAdd).then(this, [this](bool success) {
+            if (success) {
+                QMessageBox::information(this, "Success", "Stock updated successfully.");
+            }
+        });
     }
 }
 
@@ -655,15 +876,47 @@ void MainWindow::onAskCopilotClicked()
         return;
     }
 
+    // Only the in-stock medicines that plausibly fit the symptoms go into the
+    // prompt, each name once.
+    auto inStock = [this](int index) { return !m_stockStore.isRemoved(index) && m_stockStore.quantity(index) > 0; };
     QStringList stockList;
-    for (int i = 0; i < m_stockTableWidget->rowCount(); ++i) {
-        if (!m_stockTableWidget->isRowHidden(i) && m_stockTableWidget->item(i, 4)->text().toInt() > 0) {
-            stockList.append(m_stockTableWidget->item(i, 1)->text());
+    QSet<QString> listed;
+    auto offer = [&stockList, &listed](const QString& name) {
+        if (!listed.contains(name)) {
+            listed.insert(name);
+            stockList.append(name);
+        }
+    };
+    for (const MedicineRetrieval::Candidate& candidate : m_retrieval.topCandidates(symptoms, CopilotCandidates, inStock)) {
+        offer(m_stockStore.name(candidate.storeIndex));
+    }
+    if (stockList.isEmpty()) {
+        // No indication matched: the words may name a medicine instead. Still
+        // capped, so the prompt never lists the whole catalogue.
+        Metrics::counter("net.copilot.retrievalMisses")->add();
+        // Batches and sold-out rows collapse, so widen until the names fill up or matches run out
+        for (int limit = CopilotCandidates; stockList.size() < CopilotCandidates; limit *= 2) {
+            const QVector<FuzzyMedicineLookup::Match> matches = m_fuzzyLookup.lookup(symptoms, limit);
+            for (const FuzzyMedicineLookup::Match& match : matches) {
+                if (inStock(match.storeIndex)) offer(m_stockStore.name(match.storeIndex));
+                if (stockList.size() == CopilotCandidates) break;
+            }
+            if (matches.size() < limit) break;
         }
     }
 
     if (stockList.isEmpty()) {
-        QMessageBox::warning(this, "No Stock", "No medicines are in stock to make a suggestion.");
+        QMessageBox::information(this, "No Match",
+                                 "None of the medicines in stock fit these symptoms. Try describing them in other words.");
+        return;
+    }
+
+    // The same question about the same stock gets the answer it got last time
+    const QByteArray stockHash = CopilotCache::stockHash(stockList);
+    QStringList cachedSuggestions;
+    if (m_copilotCache->find(symptoms, stockHash, &cachedSuggestions)) {
+        Metrics::counter("net.copilot.cacheHits")->add();
+        showCopilotSuggestions(cachedSuggestions);
         return;
     }
 
@@ -687,11 +940,22 @@ void MainWindow::onAskCopilotClicked()
     m_askCopilotButton->setText("Thinking...");
     m_askCopilotButton->setEnabled(false);
     m_suggestionsListWidget->clear();
-    m_networkManager->post(request, QJsonDocument(jsonBody).toJson());
+    // The round trip ends in onGeminiReplyFinished(); the button keeps it to one at a time
+    m_copilotTimer.start();
+    Metrics::counter("net.copilot.requests")->add();
+    QNetworkReply *reply = m_networkManager->post(request, QJsonDocument(jsonBody).toJson());
+    reply->setProperty("symptoms", symptoms);
+    reply->setProperty("stockHash", stockHash);
 }
 
 void MainWindow::onGeminiReplyFinished(QNetworkReply *reply)
 {
+    static LatencyHistogram *const copilotLatency = Metrics::histogram("net.copilot");
+    const qint64 roundTripUs = m_copilotTimer.nsecsElapsed() / 1000;
+    copilotLatency->record(roundTripUs);
+    if (Tracing::isEnabled()) Tracing::complete("net", "Copilot round trip", Tracing::nowUs() - roundTripUs, roundTripUs);
+    if (reply->error() != QNetworkReply::NoError) Metrics::counter("net.copilot.errors")->add();
+    TRACE_SCOPE("ui", "MainWindow::onGeminiReplyFinished");
     m_askCopilotButton->setText("Ask Copilot");
     m_askCopilotButton->setEnabled(true);
 
@@ -709,12 +973,24 @@ void MainWindow::onGeminiReplyFinished(QNetworkReply *reply)
         resultText = candidates[0].toObject()["content"].toObject()["parts"].toArray()[0].toObject()["text"].toString().trimmed();
     }
 
-    if (resultText.isEmpty() || resultText.toLower() == "none") {
+    QStringList suggestions;
+    if (!resultText.isEmpty() && resultText.toLower() != "none") suggestions = resultText.split('\n', Qt::SkipEmptyParts);
+    // An empty reply body is more likely a glitch than an answer, so it is not kept
+    if (!candidates.isEmpty()) {
+        m_copilotCache->insert(reply->property("symptoms").toString(), reply->property("stockHash").toByteArray(), suggestions);
+    }
+    showCopilotSuggestions(suggestions);
+    reply->deleteLater();
+}
+
+void MainWindow::showCopilotSuggestions(const QStringList& suggestions)
+{
+    m_suggestionsListWidget->clear();
+    if (suggestions.isEmpty()) {
         m_suggestionsListWidget->addItem("No suitable medicine found.");
     } else {
-        m_suggestionsListWidget->addItems(resultText.split('\n', Qt::SkipEmptyParts));
+        m_suggestionsListWidget->addItems(suggestions);
     }
-    reply->deleteLater();
 }
 
 
@@ -725,3 +1001,11 @@ void MainWindow::onClearCopilotClicked()
         m_suggestionsListWidget->clear();
     }
 }
+
+void MainWindow::onShowDiagnostics()
+{
+    if (!m_diagnosticsDialog) m_diagnosticsDialog = new DiagnosticsDialog(this);
+    m_diagnosticsDialog->show();
+    m_diagnosticsDialog->raise();
+    m_diagnosticsDialog->activateWindow();
+}
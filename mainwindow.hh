@@ -3,12 +3,26 @@
 
 #include <QMainWindow>
 #include "databasemanager.h"
+#include "asyncdatabase.h"
 #include "modernwidgets.h" // Include your new custom widgets
+#include "stockstore.h"
+#include "stocksearchindex.h"
+#include "fuzzymedicinelookup.h"
+#include "medicineretrieval.h"
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QModelIndex>
+#include <QElapsedTimer>
 
 // Forward declarations for standard Qt widgets
-class QTableWidget;
+class QTableView;
+class StockTableModel;
+class InvoiceDetailsCache;
+class InventoryKpis;
+class CatalogImporter;
+class DataExporter;
+class DiagnosticsDialog;
+class CopilotCache;
 class QListWidget;
 class QLabel;
 class QLineEdit;
@@ -20,9 +34,15 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
+    // Most medicines PharmaCopilot is offered for one question
+    static constexpr int CopilotCandidates = 30;
+
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Sum of the line subtotals (Qt::UserRole + 1, in cents) of a cart list
+    static qint64 cartTotalCents(const QListWidget *cart);
+
 private slots:
     void onAddMedicineClicked();
     void onEditMedicineClicked();
@@ -31,37 +51,56 @@ private slots:
     void onFinalizeSaleClicked();
     void onClearCartClicked();
     void onSalesHistoryClicked();
-    void onStockTableDoubleClicked(int row, int column);
+    void onImportCatalogClicked();
+    void onReceiveGoodsClicked();
+    void onExportDataClicked();
+    void onStockTableDoubleClicked(const QModelIndex &index);
     void onSearchQueryChanged(const QString& text);
     void showTableContextMenu(const QPoint &pos);
     void onAskCopilotClicked();
     void onGeminiReplyFinished(QNetworkReply *reply);
     void onClearCopilotClicked();
+    void onMedicinesChanged(const MedicineChangeSet& changes);
+    void onShowDiagnostics();
 
 private:
     void populateStockTable();
     void updateTotalAmount();
+    // "No suitable medicine found." for an empty list
+    void showCopilotSuggestions(const QStringList& suggestions);
 
     // Helper methods for modern UI
     QString getModernStyleSheet();
     void setupModernUI();
     QFrame* createModernFrame();
     void setupModernTable();
-    void updateStockStats();
+    void refreshStatsCards();
+    // Store index of the medicine in the selected grid row, or -1
+    int selectedStoreIndex() const;
 
 private:
-    DatabaseManager *m_dbManager;
+    AsyncDatabase *m_asyncDb;       // loads and writes run on its worker thread
+    InvoiceDetailsCache *m_invoiceDetailsCache; // kept across sales history dialogs
+    CatalogImporter *m_catalogImporter;         // bulk CSV imports on their own connection
+    DataExporter *m_dataExporter;               // background exports, likewise
 
     // --- Core UI Components ---
-    QTableWidget *m_stockTableWidget;
+    QTableView *m_stockTableView;
+    StockStore m_stockStore;
+    StockSearchIndex m_searchIndex;
+    FuzzyMedicineLookup m_fuzzyLookup;
+    MedicineRetrieval m_retrieval;      // picks the medicines offered to PharmaCopilot
+    StockTableModel *m_stockModel;
     QLineEdit *m_searchLineEdit;
     QListWidget *m_cartListWidget;
     QLabel *m_totalAmountLabel;
+    ModernButton *m_finalizeSaleButton;
 
     // --- Modern Stats Cards ---
     StatsCard *m_totalStatsCard;
     StatsCard *m_lowStockCard;
     StatsCard *m_expiringCard;
+    InventoryKpis *m_kpis;        // counters behind the cards, updated per changed medicine
 
     // --- PharmaCopilot UI ---
     QLineEdit *m_symptomsLineEdit;
@@ -70,5 +109,9 @@ private:
 
     // --- Networking ---
     QNetworkAccessManager *m_networkManager;
+    QElapsedTimer m_copilotTimer;                          // started when a request is posted
+    CopilotCache *m_copilotCache;                          // answers by symptoms and in-stock medicines
+
+    DiagnosticsDialog *m_diagnosticsDialog = nullptr;      // created on first Ctrl+Shift+D
 };
 #endif // MAINWINDOW_H
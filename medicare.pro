@@ -1,4 +1,4 @@
-QT       += core gui sql network
+QT       += core gui sql network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -10,18 +10,59 @@ CONFIG += c++17
 
 SOURCES += \
     addmedicinedialog.cpp \
+    asyncdatabase.cpp \
+    catalogimporter.cpp \
+    columnarfile.cpp \
+    copilotcache.cpp \
     databasemanager.cpp \
+    databaseprofile.cpp \
+    dataexporter.cpp \
+    diagnosticsdialog.cpp \
+    fuzzymedicinelookup.cpp \
+    goodsreceiptdialog.cpp \
+    goodsreceiptmodel.cpp \
+    inventorykpis.cpp \
+    invoicedetailscache.cpp \
+    invoicelistmodel.cpp \
     main.cpp \
     mainwindow.cpp \
+    medicineretrieval.cpp \
+    metrics.cpp \
     modernwidgets.cpp \
-    saleshistorydialog.cpp
+    saleshistorydialog.cpp \
+    schemamigrations.cpp \
+    stocksearchindex.cpp \
+    stockstore.cpp \
+    stocktablemodel.cpp \
+    tracing.cpp
 
 HEADERS += \
     addmedicinedialog.h \
+    asyncdatabase.h \
+    catalogimporter.h \
+    columnarfile.h \
+    copilotcache.h \
     databasemanager.h \
+    databaseprofile.h \
+    dataexporter.h \
+    diagnosticsdialog.h \
+    fuzzymedicinelookup.h \
+    goodsreceiptdialog.h \
+    goodsreceiptmodel.h \
+    inventorykpis.h \
+    invoicedetailscache.h \
+    invoicelistmodel.h \
     mainwindow.h \
+    medicineretrieval.h \
+    metrics.h \
     modernwidgets.h \
-    saleshistorydialog.h
+    money.h \
+    saleshistorydialog.h \
+    schemamigrations.h \
+    stocksearchindex.h \
+    stockstore.h \
+    stocktablemodel.h \
+    tracing.h
 
 
 # Default rules for deployment.
@@ -0,0 +1,252 @@
+#include "medicineretrieval.h"
+#include "fuzzymedicinelookup.h"
+#include "stockstore.h"
+#include <QSet>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Common over-the-counter ingredients and what people ask for them by
+const QHash<QString, QString>& indications()
+{
+    static const QHash<QString, QString> table = [] {
+        QHash<QString, QString> t;
+        const QString analgesic = "pain ache headache fever temperature toothache migraine body cold flu";
+        const QString antiInflammatory = "pain ache headache fever inflammation swelling toothache migraine cramp period back joint muscle sprain";
+        const QString antihistamine = "allergy allergic sneeze sneezing itch itchy hive rash runny nose watery eye hay fever";
+        const QString decongestant = "congestion blocked stuffy nose sinus cold flu";
+        const QString expectorant = "cough chest congestion mucus phlegm wet productive";
+        const QString acid = "acidity acid heartburn reflux indigestion gastric stomach ulcer";
+        const QString laxative = "constipation";
+        const QString antiemetic = "nausea vomiting vomit motion travel sickness";
+        const QString antifungal = "fungal fungus athlete foot ringworm itch yeast jock";
+        const QString antiseptic = "wound cut graze infection burn skin";
+        for (const char *name : {"paracetamol", "acetaminophen", "aspirin"}) t.insert(name, analgesic);
+        for (const char *name : {"ibuprofen", "naproxen", "diclofenac", "mefenamic"}) t.insert(name, antiInflammatory);
+        for (const char *name : {"cetirizine", "levocetirizine", "loratadine", "desloratadine", "fexofenadine", "chlorpheniramine"})
+            t.insert(name, antihistamine);
+        t.insert("diphenhydramine", antihistamine + " sleep insomnia cough");
+        for (const char *name : {"pseudoephedrine", "phenylephrine", "xylometazoline", "oxymetazoline"}) t.insert(name, decongestant);
+        for (const char *name : {"guaifenesin", "ambroxol", "bromhexine", "carbocisteine"}) t.insert(name, expectorant);
+        t.insert("dextromethorphan", "cough dry tickly");
+        t.insert("menthol", "congestion cough sore throat blocked nose");
+        for (const char *name : {"benzocaine", "lidocaine", "chlorhexidine"}) t.insert(name, "sore throat mouth ulcer toothache pain");
+        for (const char *name : {"omeprazole", "esomeprazole", "pantoprazole", "rabeprazole", "famotidine", "ranitidine"})
+            t.insert(name, acid);
+        for (const char *name : {"antacid", "magnesium", "aluminium", "aluminum", "carbonate", "alginate"}) t.insert(name, acid);
+        t.insert("simethicone", "gas bloating flatulence wind colic");
+        for (const char *name : {"bisacodyl", "senna", "lactulose", "docusate", "psyllium", "ispaghula"}) t.insert(name, laxative);
+        t.insert("loperamide", "diarrhea diarrhoea loose motion stomach");
+        t.insert("ors", "diarrhea diarrhoea dehydration vomiting loose motion");
+        t.insert("rehydration", "diarrhea diarrhoea dehydration vomiting loose motion");
+        for (const char *name : {"ondansetron", "domperidone", "meclizine", "dimenhydrinate", "promethazine"}) t.insert(name, antiemetic);
+        t.insert("hydrocortisone", "itch itchy rash eczema inflammation skin bite sting");
+        t.insert("calamine", "itch itchy rash sunburn chickenpox bite sting skin");
+        for (const char *name : {"clotrimazole", "miconazole", "terbinafine", "ketoconazole", "fluconazole"}) t.insert(name, antifungal);
+        for (const char *name : {"povidone", "mupirocin", "bacitracin", "neomycin", "fusidic", "silver"}) t.insert(name, antiseptic);
+        t.insert("zinc", "cold immunity");
+        t.insert("ascorbic", "cold immunity");
+        t.insert("vitamin", "cold immunity deficiency weakness tiredness");
+        t.insert("melatonin", "sleep insomnia jet lag");
+        t.insert("permethrin", "lice scabies itch");
+        t.insert("saline", "blocked stuffy nose congestion dry eye");
+        return t;
+    }();
+    return table;
+}
+
+}
+
+QStringList MedicineRetrieval::terms(const QString& text)
+{
+    QStringList result;
+    QString word;
+    auto flush = [&result, &word]() {
+        // "headaches" and "headache" are the same symptom
+        if (word.size() > 3 && word.endsWith(QLatin1Char('s')) && !word.endsWith(QLatin1String("ss"))) word.chop(1);
+        if (!word.isEmpty()) result.append(word);
+        word.clear();
+    };
+    for (QChar c : text.toCaseFolded()) {
+        if (c.isLetterOrNumber()) word.append(c);
+        else flush();
+    }
+    flush();
+    return result;
+}
+
+bool MedicineRetrieval::isStopWord(const QString& word)
+{
+    static const QSet<QString> words = {"a", "an", "and", "the", "of", "with", "or", "i", "have", "my", "some"};
+    return words.contains(word);
+}
+
+QStringList MedicineRetrieval::documentTerms(const QString& name)
+{
+    QStringList result = terms(name);
+    const int nameWords = result.size();
+    for (int k = 0; k < nameWords; ++k) {
+        auto indication = indications().constFind(result.at(k));
+        if (indication != indications().constEnd()) result += terms(indication.value());
+    }
+    return result;
+}
+
+void MedicineRetrieval::clear()
+{
+    m_postings.clear();
+    m_termsByLength.clear();
+    m_rowTerms.clear();
+    m_rowNames.clear();
+    m_rowLength.clear();
+    m_totalLength = 0;
+    m_documents = 0;
+}
+
+void MedicineRetrieval::rebuild(const StockStore& store)
+{
+    clear();
+    m_rowTerms.resize(store.size());
+    m_rowNames.resize(store.size());
+    m_rowLength.resize(store.size());
+    for (int i = 0; i < store.size(); ++i) {
+        if (!store.isRemoved(i)) addRow(store, i);
+    }
+}
+
+void MedicineRetrieval::update(const StockStore& store, int storeIndex)
+{
+    if (storeIndex >= m_rowLength.size()) {
+        m_rowTerms.resize(storeIndex + 1);
+        m_rowNames.resize(storeIndex + 1);
+        m_rowLength.resize(storeIndex + 1);
+    }
+    // Stock and price edits leave the document alone
+    if (m_rowLength.at(storeIndex) > 0 && m_rowNames.at(storeIndex) == store.name(storeIndex)) return;
+    removeRow(storeIndex);
+    addRow(store, storeIndex);
+}
+
+void MedicineRetrieval::remove(int storeIndex)
+{
+    if (storeIndex < m_rowLength.size()) removeRow(storeIndex);
+}
+
+void MedicineRetrieval::addRow(const StockStore& store, int storeIndex)
+{
+    const QStringList document = documentTerms(store.name(storeIndex));
+    if (document.isEmpty()) return;
+
+    QHash<QString, int> frequencies;
+    for (const QString& term : document) frequencies[term]++;
+    for (auto it = frequencies.cbegin(); it != frequencies.cend(); ++it) {
+        QVector<Posting>& list = m_postings[it.key()];
+        if (list.isEmpty()) {
+            if (it.key().size() >= m_termsByLength.size()) m_termsByLength.resize(it.key().size() + 1);
+            m_termsByLength[it.key().size()].insert(it.key());
+        }
+        list.append({storeIndex, it.value()});
+    }
+    m_rowTerms[storeIndex] = frequencies.keys();
+    m_rowNames[storeIndex] = store.name(storeIndex);
+    m_rowLength[storeIndex] = document.size();
+    m_totalLength += document.size();
+    m_documents++;
+}
+
+void MedicineRetrieval::removeRow(int storeIndex)
+{
+    if (m_rowLength.at(storeIndex) == 0) return;
+    for (const QString& term : std::as_const(m_rowTerms.at(storeIndex))) {
+        auto postings = m_postings.find(term);
+        if (postings == m_postings.end()) continue;
+        QVector<Posting>& list = postings.value();
+        auto it = std::find_if(list.begin(), list.end(), [storeIndex](const Posting& p) { return p.storeIndex == storeIndex; });
+        if (it != list.end()) {
+            // Order within a posting list does not matter
+            *it = list.last();
+            list.removeLast();
+        }
+        if (list.isEmpty()) {
+            m_termsByLength[term.size()].remove(term);
+            m_postings.erase(postings);
+        }
+    }
+    m_totalLength -= m_rowLength.at(storeIndex);
+    m_documents--;
+    m_rowTerms[storeIndex].clear();
+    m_rowNames[storeIndex].clear();
+    m_rowLength[storeIndex] = 0;
+}
+
+QString MedicineRetrieval::closestTerm(const QString& term) const
+{
+    // Every name word of a large catalogue is indexed, so only words whose
+    // length is within maxDistance of the term are compared at all
+    const int maxDistance = term.size() <= 5 ? 1 : MaxTypoDistance;
+    QString best;
+    int bestDistance = maxDistance + 1;
+    const int shortest = qMax(1, int(term.size()) - maxDistance);
+    const int longest = qMin(int(m_termsByLength.size()) - 1, int(term.size()) + maxDistance);
+    for (int length = shortest; length <= longest; ++length) {
+        for (const QString& candidate : m_termsByLength.at(length)) {
+            const int distance = FuzzyMedicineLookup::editDistance(term, candidate, maxDistance);
+            // Ties go to the alphabetically first word, so the result does not depend on hash order
+            if (distance < bestDistance || (distance == bestDistance && candidate < best)) {
+                best = candidate;
+                bestDistance = distance;
+            }
+        }
+    }
+    return bestDistance <= maxDistance ? best : QString();
+}
+
+QVector<MedicineRetrieval::Candidate> MedicineRetrieval::topCandidates(const QString& symptoms, int k,
+                                                                       const std::function<bool(int)>& accept) const
+{
+    QVector<Candidate> results;
+    if (k <= 0 || m_documents == 0) return results;
+
+    QStringList queryTerms = terms(symptoms);
+    queryTerms.removeIf(isStopWord);
+    queryTerms.removeDuplicates();
+    const double averageLength = double(m_totalLength) / m_documents;
+
+    QHash<int, double> scores;
+    for (const QString& term : std::as_const(queryTerms)) {
+        auto postings = m_postings.constFind(term);
+        if (postings == m_postings.constEnd() && term.size() >= MinTypoLength) postings = m_postings.constFind(closestTerm(term));
+        if (postings == m_postings.constEnd()) continue;
+        const double documentFrequency = postings->size();
+        const double idf = std::log(1.0 + (m_documents - documentFrequency + 0.5) / (documentFrequency + 0.5));
+        for (const Posting& posting : postings.value()) {
+            const double length = m_rowLength.at(posting.storeIndex);
+            const double tf = posting.frequency;
+            scores[posting.storeIndex] += idf * tf * (K1 + 1) / (tf + K1 * (1 - B + B * length / averageLength));
+        }
+    }
+
+    results.reserve(scores.size());
+    for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+        if (accept(it.key())) results.append({it.key(), it.value()});
+    }
+    // Ties go to the lower store index, so the same stock always gives the same prompt
+    auto better = [](const Candidate& a, const Candidate& b) {
+        return a.score != b.score ? a.score > b.score : a.storeIndex < b.storeIndex;
+    };
+    std::sort(results.begin(), results.end(), better);
+
+    // Batches of one medicine share a name; only the best of them is offered
+    QSet<QString> names;
+    int kept = 0;
+    for (const Candidate& candidate : std::as_const(results)) {
+        if (kept == k) break;
+        const QString& name = m_rowNames.at(candidate.storeIndex);
+        if (names.contains(name)) continue;
+        names.insert(name);
+        results[kept++] = candidate;
+    }
+    results.resize(kept);
+    return results;
+}
@@ -0,0 +1,73 @@
+#ifndef MEDICINERETRIEVAL_H
+#define MEDICINERETRIEVAL_H
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <functional>
+
+class StockStore;
+
+// Picks the medicines worth offering PharmaCopilot for a set of symptoms, so
+// the prompt lists a few dozen candidates instead of the whole inventory.
+//
+// Each medicine is a BM25 document made of its name words plus the
+// indications of the active ingredients the name mentions ("Paracetamol
+// 500mg" also reads "pain fever headache ..."). The indication table is
+// built in; the schema has no indications column. Words are case-folded and
+// a plural "s" is dropped, on both sides. Filler words ("with", "my") are
+// dropped from the query. A query word of four or more letters that no
+// document uses is read as the closest word that one does, so "headach"
+// still finds "headache".
+class MedicineRetrieval
+{
+public:
+    struct Candidate {
+        int storeIndex;
+        double score;
+    };
+
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+    static constexpr int MaxTypoDistance = 2;   // 1 for words of five letters or fewer
+    static constexpr int MinTypoLength = 4;     // shorter words are only matched exactly
+
+    void clear();
+    void rebuild(const StockStore& store);
+    void update(const StockStore& store, int storeIndex);
+    void remove(int storeIndex);
+
+    // Up to k best-scoring medicines that accept() lets through, best first,
+    // one per name: of several batches only the best-scoring one is returned.
+    // Empty when no query word occurs in any document.
+    QVector<Candidate> topCandidates(const QString& symptoms, int k, const std::function<bool(int)>& accept) const;
+
+    static QStringList terms(const QString& text);
+    // Words that say nothing about the symptoms; CopilotCache drops them too
+    static bool isStopWord(const QString& word);
+
+private:
+    struct Posting {
+        int storeIndex;
+        int frequency;
+    };
+
+    // Name words followed by the indications of the ingredients among them
+    static QStringList documentTerms(const QString& name);
+    void addRow(const StockStore& store, int storeIndex);
+    void removeRow(int storeIndex);
+    // Indexed word nearest to term within the typo distance, or an empty string
+    QString closestTerm(const QString& term) const;
+
+    QHash<QString, QVector<Posting>> m_postings;  // term -> medicines using it
+    QVector<QSet<QString>> m_termsByLength;       // term length -> indexed terms, for typo lookup
+    QVector<QStringList> m_rowTerms;              // store index -> distinct terms, for removal
+    QVector<QString> m_rowNames;                  // store index -> indexed name
+    QVector<int> m_rowLength;                     // store index -> term count, 0 if not indexed
+    qint64 m_totalLength = 0;
+    int m_documents = 0;
+};
+
+#endif // MEDICINERETRIEVAL_H
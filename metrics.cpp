@@ -0,0 +1,179 @@
+#include "metrics.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QDebug>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+struct Registry
+{
+    QMutex mutex;
+    // Sorted by name; shared_ptr keeps handed-out pointers valid as the maps grow
+    QMap<QString, std::shared_ptr<LatencyHistogram>> histograms;
+    QMap<QString, std::shared_ptr<MetricsCounter>> counters;
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+}
+
+int LatencyHistogram::bucketIndex(qint64 micros)
+{
+    if (micros < 2 * SubBuckets) return int(qMax<qint64>(0, micros));
+    // The top six bits select the bucket: 32 per power of two from 64 up
+    const int msb = 63 - qCountLeadingZeroBits(quint64(micros));
+    const int shift = msb - 5;
+    const int index = 2 * SubBuckets + (shift - 1) * SubBuckets + int(micros >> shift) - SubBuckets;
+    return qMin(index, BucketCount - 1);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < 2 * SubBuckets) return index;
+    const int shift = (index - 2 * SubBuckets) / SubBuckets + 1;
+    const qint64 mantissa = (index - 2 * SubBuckets) % SubBuckets + SubBuckets;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 micros)
+{
+    m_buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(micros, std::memory_order_relaxed);
+    qint64 max = m_max.load(std::memory_order_relaxed);
+    while (micros > max && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::meanMicros() const
+{
+    const qint64 samples = count();
+    return samples > 0 ? double(m_sum.load(std::memory_order_relaxed)) / samples : 0.0;
+}
+
+qint64 LatencyHistogram::percentileMicros(double fraction) const
+{
+    // Buckets are summed rather than trusting m_count, which a concurrent
+    // record() may have bumped before its bucket
+    qint64 total = 0;
+    for (const auto& bucket : m_buckets) total += bucket.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    const qint64 rank = qMax<qint64>(1, qint64(std::ceil(fraction * total)));
+    qint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return qMin(bucketUpperBound(i), maxMicros());
+    }
+    return maxMicros();
+}
+
+LatencyHistogram *Metrics::histogram(const QString& name)
+{
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    auto& slot = r.histograms[name];
+    if (!slot) slot = std::make_shared<LatencyHistogram>();
+    return slot.get();
+}
+
+MetricsCounter *Metrics::counter(const QString& name)
+{
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    auto& slot = r.counters[name];
+    if (!slot) slot = std::make_shared<MetricsCounter>();
+    return slot.get();
+}
+
+QList<HistogramSnapshot> Metrics::histograms()
+{
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    QList<HistogramSnapshot> snapshots;
+    for (auto it = r.histograms.cbegin(); it != r.histograms.cend(); ++it) {
+        const LatencyHistogram& histogram = *it.value();
+        HistogramSnapshot snapshot;
+        snapshot.name = it.key();
+        snapshot.count = histogram.count();
+        snapshot.meanMicros = histogram.meanMicros();
+        snapshot.p50Micros = histogram.percentileMicros(0.50);
+        snapshot.p95Micros = histogram.percentileMicros(0.95);
+        snapshot.p99Micros = histogram.percentileMicros(0.99);
+        snapshot.maxMicros = histogram.maxMicros();
+        snapshots.append(snapshot);
+    }
+    return snapshots;
+}
+
+QList<CounterSnapshot> Metrics::counters()
+{
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    QList<CounterSnapshot> snapshots;
+    for (auto it = r.counters.cbegin(); it != r.counters.cend(); ++it) snapshots.append({it.key(), it.value()->value()});
+    return snapshots;
+}
+
+void Metrics::reset()
+{
+    Registry& r = registry();
+    QMutexLocker locker(&r.mutex);
+    for (const auto& histogram : std::as_const(r.histograms)) histogram->reset();
+    for (const auto& counter : std::as_const(r.counters)) counter->reset();
+}
+
+bool Metrics::dump(const QString& path)
+{
+    QJsonArray histogramArray;
+    for (const HistogramSnapshot& snapshot : histograms()) {
+        histogramArray.append(QJsonObject{
+            {"name", snapshot.name},
+            {"count", snapshot.count},
+            {"mean_us", snapshot.meanMicros},
+            {"p50_us", snapshot.p50Micros},
+            {"p95_us", snapshot.p95Micros},
+            {"p99_us", snapshot.p99Micros},
+            {"max_us", snapshot.maxMicros},
+        });
+    }
+    QJsonObject counterObject;
+    for (const CounterSnapshot& snapshot : counters()) counterObject.insert(snapshot.name, snapshot.value);
+
+    const QJsonObject root{
+        {"time", QDateTime::currentDateTime().toString(Qt::ISODateWithMs)},
+        {"pid", QCoreApplication::applicationPid()},
+        {"histograms", histogramArray},
+        {"counters", counterObject},
+    };
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write metrics" << path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    if (!file.commit()) {
+        qDebug() << "Failed to write metrics" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <QList>
+#include <QElapsedTimer>
+#include <atomic>
+#include <array>
+
+// Latencies in microseconds, bucketed HDR-style: exact below 64 us, then 32
+// buckets per power of two, so any percentile is within about 3% of the true
+// value up to ~19 hours. Recording is a couple of relaxed atomic increments
+// and is safe from any thread.
+class LatencyHistogram
+{
+public:
+    static constexpr int SubBuckets = 32;
+    static constexpr int BucketCount = 2 * SubBuckets + 30 * SubBuckets;
+
+    void record(qint64 micros);
+    void reset();
+
+    qint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    qint64 maxMicros() const { return m_max.load(std::memory_order_relaxed); }
+    double meanMicros() const;
+    // Upper bound of the bucket holding the given fraction of samples, e.g. 0.99
+    qint64 percentileMicros(double fraction) const;
+
+private:
+    static int bucketIndex(qint64 micros);
+    static qint64 bucketUpperBound(int index);
+
+    std::array<std::atomic<qint64>, BucketCount> m_buckets{};
+    std::atomic<qint64> m_count{0};
+    std::atomic<qint64> m_sum{0};
+    std::atomic<qint64> m_max{0};
+};
+
+class MetricsCounter
+{
+public:
+    void add(qint64 amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+    void reset() { m_value.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_value{0};
+};
+
+struct HistogramSnapshot
+{
+    QString name;
+    qint64 count = 0;
+    double meanMicros = 0;
+    qint64 p50Micros = 0;
+    qint64 p95Micros = 0;
+    qint64 p99Micros = 0;
+    qint64 maxMicros = 0;
+};
+
+struct CounterSnapshot
+{
+    QString name;
+    qint64 value = 0;
+};
+
+// Process-wide named counters and latency histograms. Names are
+// "<layer>.<operation>" with layer one of db, ui, checkout or net, so the
+// diagnostics panel can tell where time goes. Metrics live until exit, so
+// call sites keep the returned pointer (LATENCY_SCOPE does so in a static).
+namespace Metrics {
+
+LatencyHistogram *histogram(const QString& name);
+MetricsCounter *counter(const QString& name);
+
+// Sorted by name
+QList<HistogramSnapshot> histograms();
+QList<CounterSnapshot> counters();
+
+// Zeroes every metric; the names stay registered
+void reset();
+// Writes every metric as JSON; false if the file could not be written
+bool dump(const QString& path);
+
+}
+
+// Records the time until the end of the scope into a histogram
+class LatencyTimer
+{
+public:
+    explicit LatencyTimer(LatencyHistogram *histogram) : m_histogram(histogram) { m_timer.start(); }
+    ~LatencyTimer() { m_histogram->record(m_timer.nsecsElapsed() / 1000); }
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+private:
+    LatencyHistogram *m_histogram;
+    QElapsedTimer m_timer;
+};
+
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block into the histogram called name
+#define LATENCY_SCOPE(name) \
+    static LatencyHistogram *const METRICS_CONCAT(latencyHistogram, __LINE__) = Metrics::histogram(name); \
+    LatencyTimer METRICS_CONCAT(latencyTimer, __LINE__)(METRICS_CONCAT(latencyHistogram, __LINE__))
+
+#endif // METRICS_H
@@ -0,0 +1,24 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Money is held as integer cents from the database to the cart total.
+// Doubles only appear at the edges (spin boxes, labels) and are rounded
+// once on the way in, so sums never drift.
+namespace Money {
+
+inline qint64 toCents(double amount) { return qRound64(amount * 100.0); }
+inline double fromCents(qint64 cents) { return cents / 100.0; }
+
+// "12.05", "-0.50"
+inline QString format(qint64 cents)
+{
+    const qint64 magnitude = qAbs(cents);
+    return QString("%1%2.%3").arg(cents < 0 ? "-" : "").arg(magnitude / 100).arg(magnitude % 100, 2, 10, QChar('0'));
+}
+
+}
+
+#endif // MONEY_H
@@ -1,27 +1,53 @@
 #include "saleshistorydialog.h"
+#include "invoicelistmodel.h"
+#include "money.h"
+#include "invoicedetailscache.h"
+#include "stockstore.h"
+#include "stocksearchindex.h"
+#include <QItemSelectionModel>
+#include <QScrollBar>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QGroupBox>
 #include <QTableWidget>
+#include <QTableView>
 #include <QHeaderView>
 #include <QTableWidgetItem>
+#include <QFormLayout>
+#include <QDateEdit>
+#include <QDoubleSpinBox>
+#include <QLineEdit>
+#include <QCompleter>
+#include <QStringListModel>
+#include <QPushButton>
+#include <QMessageBox>
+#include <QSet>
+#include <algorithm>
 #include <QDebug>
 
-SalesHistoryDialog::SalesHistoryDialog(DatabaseManager *dbManager, QWidget *parent)
-    : QDialog(parent), m_dbManager(dbManager)
+SalesHistoryDialog::SalesHistoryDialog(AsyncDatabase *database, InvoiceDetailsCache *detailsCache, const StockStore *stockStore,
+                                       const StockSearchIndex *searchIndex, QWidget *parent)
+    : QDialog(parent), m_database(database), m_detailsCache(detailsCache), m_stockStore(stockStore), m_searchIndex(searchIndex)
 {
     setWindowTitle("Sales History & Invoice Details");
     setMinimumSize(800, 600);
     setupUI();
 
-    populateInvoicesTable();
+    // Follows the current row, so keyboard navigation updates the details too
+    connect(m_invoicesTable->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+            [this](const QModelIndex &current) { onInvoiceSelected(current); });
 
-    connect(m_invoicesTable, &QTableWidget::cellClicked, this, &SalesHistoryDialog::onInvoiceSelected);
-
-    if (m_invoicesTable->rowCount() > 0) {
-        m_invoicesTable->selectRow(0);
-        onInvoiceSelected(0, 0);
-    }
+    // The first invoice is selected once the first page arrives from the worker
+    connect(m_invoicesModel, &InvoiceListModel::pageLoaded, this, [this](int firstRow, int) {
+        if (firstRow != 0) return;
+        m_invoicesTable->selectRow(0); // current row change shows its details
+    });
+    // Rows scrolled into view are prefetched, whether already loaded or arriving in a new page
+    connect(m_invoicesTable->verticalScrollBar(), &QScrollBar::valueChanged, this, &SalesHistoryDialog::prefetchVisibleDetails);
+    connect(m_invoicesModel, &InvoiceListModel::pageLoaded, this, [this](int firstRow, int) {
+        if (firstRow > 0) prefetchVisibleDetails();
+    });
+    m_invoicesModel->refresh();
 }
 
 void SalesHistoryDialog::setupUI()
@@ -30,9 +56,9 @@ void SalesHistoryDialog::setupUI()
     QGroupBox *invoicesGroup = new QGroupBox("Invoices");
     QVBoxLayout *invoicesLayout = new QVBoxLayout();
 
-    m_invoicesTable = new QTableWidget(this);
-    m_invoicesTable->setColumnCount(3);
-    m_invoicesTable->setHorizontalHeaderLabels({"ID", "Date of Sale", "Total Amount"});
+    m_invoicesModel = new InvoiceListModel(m_database, this);
+    m_invoicesTable = new QTableView(this);
+    m_invoicesTable->setModel(m_invoicesModel);
     m_invoicesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_invoicesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_invoicesTable->setSelectionMode(QAbstractItemView::SingleSelection);
@@ -40,6 +66,7 @@ void SalesHistoryDialog::setupUI()
     m_invoicesTable->setColumnHidden(0, true);
     m_invoicesTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 
+    invoicesLayout->addWidget(createFilterBox());
     invoicesLayout->addWidget(m_invoicesTable);
     invoicesGroup->setLayout(invoicesLayout);
     QGroupBox *detailsGroup = new QGroupBox("Invoice Details");
@@ -60,46 +87,168 @@ void SalesHistoryDialog::setupUI()
     this->setLayout(mainLayout);
 }
 
-void SalesHistoryDialog::populateInvoicesTable()
+QGroupBox* SalesHistoryDialog::createFilterBox()
 {
-    if (!m_dbManager) {
-        qWarning() << "DatabaseManager not available in SalesHistoryDialog.";
-        return;
+    m_filterGroup = new QGroupBox("Filter");
+    m_filterGroup->setCheckable(true);
+    m_filterGroup->setChecked(false);
+    QFormLayout *filterLayout = new QFormLayout();
+
+    const QDate today = QDate::currentDate();
+    m_fromDateEdit = new QDateEdit(QDate(today.year(), today.month(), 1), this);
+    m_toDateEdit = new QDateEdit(today, this);
+    for (QDateEdit *dateEdit : {m_fromDateEdit, m_toDateEdit}) {
+        dateEdit->setDisplayFormat("yyyy-MM-dd");
+        dateEdit->setCalendarPopup(true);
     }
 
-    m_invoicesTable->setRowCount(0);
+    m_minTotalSpinBox = new QDoubleSpinBox(this);
+    m_maxTotalSpinBox = new QDoubleSpinBox(this);
+    for (QDoubleSpinBox *spinBox : {m_minTotalSpinBox, m_maxTotalSpinBox}) {
+        spinBox->setRange(0.0, 9999999.99);
+        spinBox->setDecimals(2);
+        spinBox->setPrefix("$ ");
+        spinBox->setSpecialValueText("Any");
+    }
 
-    QList<QVariantList> invoices = m_dbManager->getInvoices();
-    m_invoicesTable->setRowCount(invoices.count());
+    // Suggestions come from the stock already in memory, a few at a time, so
+    // opening the dialog never walks the catalogue
+    m_medicineEdit = new QLineEdit(this);
+    m_medicineEdit->setPlaceholderText("Any medicine (type to search)");
+    m_medicineEdit->setClearButtonEnabled(true);
+    m_medicineSuggestions = new QStringListModel(this);
+    m_medicineCompleter = new QCompleter(m_medicineSuggestions, this);
+    m_medicineCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    m_medicineCompleter->setMaxVisibleItems(12);
+    m_medicineEdit->setCompleter(m_medicineCompleter);
+    connect(m_medicineEdit, &QLineEdit::textEdited, this, &SalesHistoryDialog::onMedicineTextEdited);
+    connect(m_medicineCompleter, QOverload<const QString&>::of(&QCompleter::activated), this, [this](const QString& text) {
+        m_medicineId = m_suggestionIds.value(text, 0);
+    });
 
-    for (int i = 0; i < invoices.count(); ++i) {
-        const QVariantList& invoiceData = invoices.at(i);
+    QPushButton *applyButton = new QPushButton("Search", this);
+    connect(applyButton, &QPushButton::clicked, this, &SalesHistoryDialog::applyFilters);
+    connect(m_filterGroup, &QGroupBox::toggled, this, &SalesHistoryDialog::applyFilters);
 
-        QTableWidgetItem *idItem = new QTableWidgetItem(invoiceData[0].toString());
-        idItem->setData(Qt::UserRole, invoiceData[0]);
-        m_invoicesTable->setItem(i, 0, idItem);
+    filterLayout->addRow("From:", m_fromDateEdit);
+    filterLayout->addRow("To:", m_toDateEdit);
+    filterLayout->addRow("Min total:", m_minTotalSpinBox);
+    filterLayout->addRow("Max total:", m_maxTotalSpinBox);
+    filterLayout->addRow("Medicine:", m_medicineEdit);
+    filterLayout->addRow(applyButton);
+    m_filterGroup->setLayout(filterLayout);
+    return m_filterGroup;
+}
+
+void SalesHistoryDialog::onMedicineTextEdited(const QString& text)
+{
+    // Typing after a pick clears it until another suggestion is chosen
+    m_medicineId = 0;
+    m_suggestionIds.clear();
 
-        // Column 1: Date
-        QTableWidgetItem *dateItem = new QTableWidgetItem(invoiceData[1].toString());
-        m_invoicesTable->setItem(i, 1, dateItem);
-        double total = invoiceData[2].toDouble();
-        QTableWidgetItem *totalItem = new QTableWidgetItem(QString::number(total, 'f', 2));
-        totalItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        m_invoicesTable->setItem(i, 2, totalItem);
+    const QString query = text.trimmed();
+    QStringList suggestions;
+    if (query.size() >= 2) {
+        const QVector<int> matches = m_searchIndex->search(query);
+        for (int i = 0; i < matches.size() && suggestions.size() < MaxMedicineSuggestions; ++i) {
+            const int index = matches.at(i);
+            const QString suggestion = QString("%1 (%2)").arg(m_stockStore->name(index), m_stockStore->batchNumber(index));
+            if (m_suggestionIds.contains(suggestion)) continue;
+            m_suggestionIds.insert(suggestion, m_stockStore->id(index));
+            suggestions.append(suggestion);
+        }
+        std::sort(suggestions.begin(), suggestions.end(), [](const QString& a, const QString& b) {
+            return QString::localeAwareCompare(a, b) < 0;
+        });
     }
+    m_medicineSuggestions->setStringList(suggestions);
 }
 
-void SalesHistoryDialog::onInvoiceSelected(int row, int column)
+void SalesHistoryDialog::applyFilters()
 {
-    Q_UNUSED(column);
-    QTableWidgetItem *idItem = m_invoicesTable->item(row, 0);
-    if (!idItem) return;
-
-    qint64 invoiceId = idItem->data(Qt::UserRole).toLongLong();
+    InvoiceFilter filter;
+    if (m_filterGroup->isChecked()) {
+        filter.from = m_fromDateEdit->date();
+        filter.to = m_toDateEdit->date();
+        if (m_minTotalSpinBox->value() > 0) filter.minTotalCents = Money::toCents(m_minTotalSpinBox->value());
+        if (m_maxTotalSpinBox->value() > 0) filter.maxTotalCents = Money::toCents(m_maxTotalSpinBox->value());
+        filter.medicineId = resolveMedicineFilter();
+    }
 
+    // The first match is selected once its page arrives
     m_detailsTable->setRowCount(0);
+    m_invoicesModel->setFilter(filter);
+}
+
+int SalesHistoryDialog::resolveMedicineFilter()
+{
+    const QString text = m_medicineEdit->text().trimmed();
+    if (text.isEmpty() || m_medicineId > 0) return m_medicineId;
+
+    // Typed but never picked: take the suggestion it names, or the only
+    // medicine its suggestions point at
+    int resolved = m_suggestionIds.value(text, 0);
+    const QList<int> ids = m_suggestionIds.values();
+    const QSet<int> distinctIds(ids.begin(), ids.end());
+    if (resolved == 0 && distinctIds.size() == 1) resolved = *distinctIds.begin();
+    if (resolved > 0) {
+        m_medicineId = resolved;
+        return resolved;
+    }
 
-    QList<QVariantList> details = m_dbManager->getInvoiceDetails(invoiceId);
+    // The list must not claim a medicine filter it did not apply
+    m_medicineEdit->clear();
+    m_suggestionIds.clear();
+    m_medicineSuggestions->setStringList({});
+    const QString reason = distinctIds.isEmpty()
+        ? QString("No medicine matches \"%1\"").arg(text)
+        : QString("\"%1\" matches %2 medicines").arg(text).arg(distinctIds.size());
+    QMessageBox::information(this, "Choose a Medicine",
+                             reason + ", so the medicine filter was not applied. "
+                             "Type the name again and choose one of the suggestions.");
+    return 0;
+}
+
+void SalesHistoryDialog::onInvoiceSelected(const QModelIndex &index)
+{
+    qint64 invoiceId = m_invoicesModel->invoiceId(index.row());
+    if (invoiceId < 0) return;
+
+    if (const QList<QVariantList> *details = m_detailsCache->find(invoiceId)) {
+        // A query for the previously selected invoice must not overwrite these lines
+        m_database->cancel("salesHistory/details");
+        showDetails(*details);
+    } else {
+        m_detailsTable->setRowCount(0);
+        // Moving through invoices supersedes any detail query still in flight
+        m_detailsCache->details(invoiceId, "salesHistory/details").then(this, [this, invoiceId](const QList<QVariantList>& details) {
+            // The selection may have moved on while the query ran
+            if (m_invoicesModel->invoiceId(m_invoicesTable->currentIndex().row()) != invoiceId) return;
+            showDetails(details);
+        });
+    }
+
+    prefetchVisibleDetails();
+}
+
+void SalesHistoryDialog::prefetchVisibleDetails()
+{
+    // Everything on screen plus a few rows either side, so arrowing is served from the cache
+    const int margin = 5;
+    int first = m_invoicesTable->rowAt(0);
+    int last = m_invoicesTable->rowAt(m_invoicesTable->viewport()->height() - 1);
+    if (first < 0) first = 0;
+    if (last < 0) last = m_invoicesModel->rowCount() - 1;
+
+    QList<qint64> ids;
+    for (int row = qMax(0, first - margin); row <= qMin(m_invoicesModel->rowCount() - 1, last + margin); ++row) {
+        ids.append(m_invoicesModel->invoiceId(row));
+    }
+    m_detailsCache->prefetch(ids);
+}
+
+void SalesHistoryDialog::showDetails(const QList<QVariantList>& details)
+{
     m_detailsTable->setRowCount(details.count());
 
     for (int i = 0; i < details.count(); ++i) {
@@ -2,33 +2,76 @@
 #define SALESHISTORYDIALOG_H
 
 #include <QDialog>
-#include "databasemanager.h" // Essential for data access
+#include <QModelIndex>
+#include <QHash>
+#include "asyncdatabase.h" // Essential for data access
 
 // Forward declarations for UI elements to keep header clean
 class QTableWidget;
+class QTableView;
 class QGroupBox;
+class QDateEdit;
+class QDoubleSpinBox;
+class QLineEdit;
+class QCompleter;
+class QStringListModel;
+class InvoiceListModel;
+class InvoiceDetailsCache;
+class StockStore;
+class StockSearchIndex;
 
 class SalesHistoryDialog : public QDialog
 {
     Q_OBJECT
 
 public:
-    // Constructor that takes a pointer to the database manager
-    explicit SalesHistoryDialog(DatabaseManager *dbManager, QWidget *parent = nullptr);
+    static constexpr int MaxMedicineSuggestions = 50;
+
+    // Constructor that takes the asynchronous database front end, the shared
+    // invoice details cache and the in-memory stock with its search index, all
+    // owned by the caller so they outlive the dialog
+    SalesHistoryDialog(AsyncDatabase *database, InvoiceDetailsCache *detailsCache, const StockStore *stockStore,
+                       const StockSearchIndex *searchIndex, QWidget *parent = nullptr);
 
 private slots:
     // Slot to be triggered when a user clicks on an invoice in the left table
-    void onInvoiceSelected(int row, int column);
+    void onInvoiceSelected(const QModelIndex &index);
+    // Re-runs the invoice search with the criteria in the filter box
+    void applyFilters();
+    // Offers the loaded medicines matching what was typed in the medicine filter
+    void onMedicineTextEdited(const QString& text);
 
 private:
     // Helper function to set up the entire UI for this dialog
     void setupUI();
-    // Helper function to load all invoices from the DB into the left table
-    void populateInvoicesTable();
+    QGroupBox* createFilterBox();
+    void showDetails(const QList<QVariantList>& details);
+    // Warms the details cache for the invoices around the visible rows
+    void prefetchVisibleDetails();
+    // Medicine ID for the filter; a typed name without a pick resolves only
+    // when unambiguous, otherwise the box is cleared and the user told why
+    int resolveMedicineFilter();
 
-    DatabaseManager *m_dbManager;      // Pointer to the main database manager
-    QTableWidget *m_invoicesTable;     // Table to display the list of all invoices
+    AsyncDatabase *m_database;         // Queries run on the database worker thread
+    InvoiceDetailsCache *m_detailsCache;
+    InvoiceListModel *m_invoicesModel; // Pages of invoices, fetched as the list scrolls
+    QTableView *m_invoicesTable;       // Table to display the list of all invoices
     QTableWidget *m_detailsTable;      // Table to display items for a selected invoice
+
+    // --- Search filters ---
+    QGroupBox *m_filterGroup;          // checkable; unchecked lists every invoice
+    QDateEdit *m_fromDateEdit;
+    QDateEdit *m_toDateEdit;
+    QDoubleSpinBox *m_minTotalSpinBox; // 0 means no lower bound
+    QDoubleSpinBox *m_maxTotalSpinBox; // 0 means no upper bound
+    QLineEdit *m_medicineEdit;         // type-ahead; empty means any medicine
+    QCompleter *m_medicineCompleter;
+    QStringListModel *m_medicineSuggestions;
+    QHash<QString, int> m_suggestionIds; // suggestion text -> medicine ID
+    int m_medicineId = 0;              // chosen suggestion, 0 for any
+
+    const StockStore *m_stockStore;
+    const StockSearchIndex *m_searchIndex;
 };
 
 #endif // SALESHISTORYDIALOG_H
@@ -0,0 +1,123 @@
+#include "schemamigrations.h"
+
+const QList<SchemaMigration>& SchemaMigration::all()
+{
+    static const QList<SchemaMigration> migrations = {
+        // Databases created before versioning sit at user_version 0 and already
+        // have some of these tables, hence IF NOT EXISTS
+        {1, "Base tables", {
+            "CREATE TABLE IF NOT EXISTS Medicines ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "name TEXT NOT NULL, "
+            "batchNumber TEXT, "
+            "expiryDate TEXT, "
+            "quantity INTEGER, "
+            "price REAL"
+            ")",
+            "CREATE TABLE IF NOT EXISTS Invoices ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "saleDate TEXT, "
+            "totalAmount REAL"
+            ")",
+            "CREATE TABLE IF NOT EXISTS InvoiceItems ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "invoiceId INTEGER, "
+            "medicineId INTEGER, "
+            "quantitySold INTEGER, "
+            "priceAtSale REAL, "
+            "FOREIGN KEY(invoiceId) REFERENCES Invoices(id), "
+            "FOREIGN KEY(medicineId) REFERENCES Medicines(id)"
+            ")",
+            // One short-lived reservation per medicine and terminal
+            "CREATE TABLE IF NOT EXISTS StockHolds ("
+            "medicineId INTEGER NOT NULL, "
+            "terminalId TEXT NOT NULL, "
+            "quantity INTEGER NOT NULL, "
+            "expiresAt INTEGER NOT NULL, "
+            "PRIMARY KEY(medicineId, terminalId)"
+            ") WITHOUT ROWID",
+        }},
+        // Invoice details, the delete-medicine guard and date filters were full
+        // table scans that grew with every sale
+        {2, "Indexes for invoice lookups", {
+            "CREATE INDEX IF NOT EXISTS idx_InvoiceItems_invoiceId ON InvoiceItems(invoiceId)",
+            "CREATE INDEX IF NOT EXISTS idx_InvoiceItems_medicineId ON InvoiceItems(medicineId)",
+            "CREATE INDEX IF NOT EXISTS idx_Invoices_saleDate ON Invoices(saleDate)",
+        }},
+        // Expiry becomes a Julian day number and money integer cents, so expiry
+        // and stock predicates are indexed integer comparisons and totals are exact
+        {3, "Integer expiry days and money in cents", {
+            "ALTER TABLE Medicines ADD COLUMN expiryDay INTEGER",
+            "ALTER TABLE Medicines ADD COLUMN priceCents INTEGER NOT NULL DEFAULT 0",
+            "UPDATE Medicines SET expiryDay = CAST(julianday(expiryDate) + 0.5 AS INTEGER), "
+            "priceCents = CAST(ROUND(price * 100) AS INTEGER)",
+            "ALTER TABLE Medicines DROP COLUMN expiryDate",
+            "ALTER TABLE Medicines DROP COLUMN price",
+            "ALTER TABLE Invoices ADD COLUMN totalCents INTEGER NOT NULL DEFAULT 0",
+            "UPDATE Invoices SET totalCents = CAST(ROUND(totalAmount * 100) AS INTEGER)",
+            "ALTER TABLE Invoices DROP COLUMN totalAmount",
+            "ALTER TABLE InvoiceItems ADD COLUMN priceAtSaleCents INTEGER NOT NULL DEFAULT 0",
+            "UPDATE InvoiceItems SET priceAtSaleCents = CAST(ROUND(priceAtSale * 100) AS INTEGER)",
+            "ALTER TABLE InvoiceItems DROP COLUMN priceAtSale",
+            "CREATE INDEX IF NOT EXISTS idx_Medicines_expiryDay ON Medicines(expiryDay)",
+            "CREATE INDEX IF NOT EXISTS idx_Medicines_quantity ON Medicines(quantity)",
+        }},
+        // Covering indexes for the sales history filters. Each replaces an index
+        // that is now its prefix.
+        {4, "Covering indexes for invoice search", {
+            "DROP INDEX IF EXISTS idx_InvoiceItems_medicineId",
+            "CREATE INDEX IF NOT EXISTS idx_InvoiceItems_medicine_invoice ON InvoiceItems(medicineId, invoiceId)",
+            "DROP INDEX IF EXISTS idx_Invoices_saleDate",
+            "CREATE INDEX IF NOT EXISTS idx_Invoices_saleDate_total ON Invoices(saleDate, totalCents)",
+        }},
+        // Per-day rollups kept current by createInvoice, so dashboards read one
+        // row per day instead of every invoice line. Days are Julian day numbers.
+        {5, "Sales rollup tables", QStringList{
+            "CREATE TABLE IF NOT EXISTS DailySales ("
+            "day INTEGER PRIMARY KEY, "
+            "invoiceCount INTEGER NOT NULL, "
+            "unitsSold INTEGER NOT NULL, "
+            "revenueCents INTEGER NOT NULL"
+            ")",
+            "CREATE TABLE IF NOT EXISTS DailyMedicineSales ("
+            "day INTEGER NOT NULL, "
+            "medicineId INTEGER NOT NULL, "
+            "unitsSold INTEGER NOT NULL, "
+            "revenueCents INTEGER NOT NULL, "
+            "PRIMARY KEY(day, medicineId)"
+            ") WITHOUT ROWID",
+            "CREATE INDEX IF NOT EXISTS idx_DailyMedicineSales_medicine ON DailyMedicineSales(medicineId, day)",
+        } + salesRollupRebuild()},
+        // Bulk imports match incoming catalog lines to stock by batch number
+        {6, "Batch number index", {
+            "CREATE INDEX IF NOT EXISTS idx_Medicines_batchNumber ON Medicines(batchNumber)",
+        }},
+    };
+    return migrations;
+}
+
+QStringList SchemaMigration::salesRollupRebuild()
+{
+    // saleDate is local ISO text; its first ten characters are the sale day
+    return {
+        "DELETE FROM DailySales",
+        "DELETE FROM DailyMedicineSales",
+        "INSERT INTO DailySales (day, invoiceCount, unitsSold, revenueCents) "
+        "SELECT CAST(julianday(substr(v.saleDate, 1, 10)) + 0.5 AS INTEGER) AS day, COUNT(*), "
+        "       SUM(COALESCE(l.units, 0)), SUM(COALESCE(l.revenue, 0)) "
+        "FROM Invoices v "
+        "LEFT JOIN (SELECT invoiceId, SUM(quantitySold) AS units, SUM(quantitySold * priceAtSaleCents) AS revenue "
+        "           FROM InvoiceItems GROUP BY invoiceId) l ON l.invoiceId = v.id "
+        "WHERE day IS NOT NULL GROUP BY day",
+        "INSERT INTO DailyMedicineSales (day, medicineId, unitsSold, revenueCents) "
+        "SELECT CAST(julianday(substr(v.saleDate, 1, 10)) + 0.5 AS INTEGER) AS day, i.medicineId, "
+        "       SUM(i.quantitySold), SUM(i.quantitySold * i.priceAtSaleCents) "
+        "FROM InvoiceItems i JOIN Invoices v ON v.id = i.invoiceId "
+        "WHERE day IS NOT NULL GROUP BY day, i.medicineId",
+    };
+}
+
+int SchemaMigration::latestVersion()
+{
+    return all().isEmpty() ? 0 : all().last().version;
+}
@@ -0,0 +1,26 @@
+#ifndef SCHEMAMIGRATIONS_H
+#define SCHEMAMIGRATIONS_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// One step in the schema's history. DatabaseManager applies pending steps
+// in version order, each in its own transaction, and records the last one
+// applied in PRAGMA user_version. Append new steps; never edit old ones.
+struct SchemaMigration
+{
+    int version;
+    QString description;
+    QStringList statements;
+
+    // Every migration, oldest first; versions start at 1 with no gaps
+    static const QList<SchemaMigration>& all();
+    static int latestVersion();
+
+    // Recomputes DailySales and DailyMedicineSales from the invoices. Used by
+    // the migration that adds them and by DatabaseManager::rebuildSalesRollups().
+    static QStringList salesRollupRebuild();
+};
+
+#endif // SCHEMAMIGRATIONS_H
@@ -0,0 +1,165 @@
+#include "stocksearchindex.h"
+#include "stockstore.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+// Keeps a query from matching across the boundary of two fields
+const QChar FieldSeparator(0x1f);
+}
+
+void StockSearchIndex::clear()
+{
+    m_folded.clear();
+    m_charMasks.clear();
+    m_postings.clear();
+}
+
+void StockSearchIndex::rebuild(const StockStore& store)
+{
+    clear();
+    m_folded.resize(store.size());
+    m_charMasks.resize(store.size());
+    // Walking store indices in ascending order keeps every posting list sorted
+    for (int i = 0; i < store.size(); ++i) {
+        if (store.isRemoved(i)) continue;
+        m_folded[i] = foldedFields(store, i);
+        m_charMasks[i] = charMask(m_folded.at(i));
+        addPostings(i);
+    }
+}
+
+void StockSearchIndex::update(const StockStore& store, int storeIndex)
+{
+    if (storeIndex >= m_folded.size()) {
+        m_folded.resize(storeIndex + 1);
+        m_charMasks.resize(storeIndex + 1);
+    }
+    const QString folded = foldedFields(store, storeIndex);
+    if (folded == m_folded.at(storeIndex)) return; // e.g. only the quantity changed
+
+    removePostings(storeIndex);
+    m_folded[storeIndex] = folded;
+    m_charMasks[storeIndex] = charMask(folded);
+    addPostings(storeIndex);
+}
+
+void StockSearchIndex::remove(int storeIndex)
+{
+    if (storeIndex >= m_folded.size()) return;
+    removePostings(storeIndex);
+    m_folded[storeIndex].clear();
+    m_charMasks[storeIndex] = 0;
+}
+
+QVector<int> StockSearchIndex::search(const QString& text) const
+{
+    const QString query = text.toCaseFolded();
+    QVector<int> result;
+    if (query.isEmpty()) return result;
+
+    if (query.size() < 3) {
+        const quint64 queryMask = charMask(query);
+        // A single ASCII letter or digit owns its mask bit, so the mask test is exact
+        const bool maskIsExact = query.size() == 1 && query.at(0).unicode() < 128 && query.at(0).isLetterOrNumber();
+        for (int i = 0; i < m_charMasks.size(); ++i) {
+            if ((m_charMasks.at(i) & queryMask) != queryMask) continue;
+            if (maskIsExact || m_folded.at(i).contains(query)) result.append(i);
+        }
+        return result;
+    }
+
+    // Intersect posting lists, shortest first, then verify the survivors
+    QVector<const QVector<int>*> lists;
+    for (quint64 gram : trigrams(query)) {
+        auto it = m_postings.constFind(gram);
+        if (it == m_postings.constEnd()) return result;
+        lists.append(&it.value());
+    }
+    if (lists.isEmpty()) return result;
+    std::sort(lists.begin(), lists.end(), [](const QVector<int>* a, const QVector<int>* b) {
+        return a->size() < b->size();
+    });
+
+    QVector<int> candidates = *lists.first();
+    QVector<int> scratch;
+    for (int k = 1; k < lists.size() && !candidates.isEmpty(); ++k) {
+        scratch.clear();
+        std::set_intersection(candidates.cbegin(), candidates.cend(), lists.at(k)->cbegin(), lists.at(k)->cend(),
+                              std::back_inserter(scratch));
+        candidates.swap(scratch);
+    }
+
+    result.reserve(candidates.size());
+    for (int i : candidates) {
+        if (m_folded.at(i).contains(query)) result.append(i);
+    }
+    return result;
+}
+
+bool StockSearchIndex::matches(int storeIndex, const QString& text) const
+{
+    if (storeIndex < 0 || storeIndex >= m_folded.size()) return false;
+    return m_folded.at(storeIndex).contains(text.toCaseFolded());
+}
+
+QString StockSearchIndex::foldedFields(const StockStore& store, int storeIndex)
+{
+    return (store.name(storeIndex) + FieldSeparator + store.batchNumber(storeIndex) + FieldSeparator
+            + QString::number(store.id(storeIndex))).toCaseFolded();
+}
+
+quint64 StockSearchIndex::charBit(QChar c)
+{
+    const ushort u = c.unicode();
+    if (u >= 'a' && u <= 'z') return quint64(1) << (u - 'a');
+    if (u >= '0' && u <= '9') return quint64(1) << (26 + u - '0');
+    // Everything else shares the remaining buckets
+    return quint64(1) << (36 + u % 28);
+}
+
+quint64 StockSearchIndex::charMask(const QString& folded)
+{
+    quint64 mask = 0;
+    for (QChar c : folded) {
+        if (c != FieldSeparator) mask |= charBit(c);
+    }
+    return mask;
+}
+
+QVector<quint64> StockSearchIndex::trigrams(const QString& folded)
+{
+    QVector<quint64> grams;
+    for (int i = 0; i + 2 < folded.size(); ++i) {
+        const QChar a = folded.at(i), b = folded.at(i + 1), c = folded.at(i + 2);
+        if (a == FieldSeparator || b == FieldSeparator || c == FieldSeparator) continue;
+        grams.append((quint64(a.unicode()) << 32) | (quint64(b.unicode()) << 16) | quint64(c.unicode()));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+void StockSearchIndex::addPostings(int storeIndex)
+{
+    for (quint64 gram : trigrams(m_folded.at(storeIndex))) {
+        QVector<int>& list = m_postings[gram];
+        if (list.isEmpty() || list.last() < storeIndex) {
+            list.append(storeIndex);
+        } else {
+            list.insert(std::lower_bound(list.begin(), list.end(), storeIndex), storeIndex);
+        }
+    }
+}
+
+void StockSearchIndex::removePostings(int storeIndex)
+{
+    for (quint64 gram : trigrams(m_folded.at(storeIndex))) {
+        auto it = m_postings.find(gram);
+        if (it == m_postings.end()) continue;
+        QVector<int>& list = it.value();
+        auto pos = std::lower_bound(list.begin(), list.end(), storeIndex);
+        if (pos != list.end() && *pos == storeIndex) list.erase(pos);
+        if (list.isEmpty()) m_postings.erase(it);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef STOCKSEARCHINDEX_H
+#define STOCKSEARCHINDEX_H
+
+#include <QVector>
+#include <QString>
+#include <QHash>
+
+class StockStore;
+
+// Case-folded substring index over the name, batch number and ID of every
+// medicine in a StockStore. Queries of three or more characters intersect
+// trigram posting lists; shorter queries are pre-filtered with a per-row
+// character mask. Either way only candidate rows are string-compared.
+class StockSearchIndex
+{
+public:
+    void clear();
+    void rebuild(const StockStore& store);
+
+    // Indexes the medicine at storeIndex, replacing any previous entry for it
+    void update(const StockStore& store, int storeIndex);
+    void remove(int storeIndex);
+
+    // Store indices (ascending) whose searchable fields contain text
+    QVector<int> search(const QString& text) const;
+    bool matches(int storeIndex, const QString& text) const;
+
+private:
+    static QString foldedFields(const StockStore& store, int storeIndex);
+    static quint64 charBit(QChar c);
+    static quint64 charMask(const QString& folded);
+    static QVector<quint64> trigrams(const QString& folded);
+
+    void addPostings(int storeIndex);
+    void removePostings(int storeIndex);
+
+    QVector<QString> m_folded;      // per store index; empty once removed
+    QVector<quint64> m_charMasks;   // per store index
+    QHash<quint64, QVector<int>> m_postings; // trigram -> ascending store indices
+};
+
+#endif // STOCKSEARCHINDEX_H
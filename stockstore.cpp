@@ -0,0 +1,78 @@
+#include "stockstore.h"
+
+void StockStore::clear()
+{
+    m_ids.clear();
+    m_names.clear();
+    m_batches.clear();
+    m_expiryDays.clear();
+    m_quantities.clear();
+    m_priceCents.clear();
+    m_indexById.clear();
+}
+
+void StockStore::reserve(int count)
+{
+    m_ids.reserve(count);
+    m_names.reserve(count);
+    m_batches.reserve(count);
+    m_expiryDays.reserve(count);
+    m_quantities.reserve(count);
+    m_priceCents.reserve(count);
+    m_indexById.reserve(count);
+}
+
+int StockStore::append(int id, const QString& name, const QString& batchNumber, qint64 expiryDay, int quantity, qint64 priceCents)
+{
+    const int index = m_ids.size();
+    m_ids.append(id);
+    m_names.append(name);
+    m_batches.append(batchNumber);
+    m_expiryDays.append(expiryDay);
+    m_quantities.append(quantity);
+    m_priceCents.append(priceCents);
+    m_indexById.insert(id, index);
+    return index;
+}
+
+int StockStore::upsert(int id, const QString& name, const QString& batchNumber, qint64 expiryDay, int quantity, qint64 priceCents)
+{
+    const int index = indexOfId(id);
+    if (index < 0) {
+        return append(id, name, batchNumber, expiryDay, quantity, priceCents);
+    }
+    m_names[index] = name;
+    m_batches[index] = batchNumber;
+    m_expiryDays[index] = expiryDay;
+    m_quantities[index] = quantity;
+    m_priceCents[index] = priceCents;
+    return index;
+}
+
+void StockStore::remove(int index)
+{
+    m_indexById.remove(m_ids.at(index));
+    m_ids[index] = -1;
+    m_names[index].clear();
+    m_batches[index].clear();
+}
+
+QString StockStore::expiryText(int index) const
+{
+    return expiryDate(index).toString("yyyy-MM-dd");
+}
+
+StockStore::Status StockStore::status(int index, qint64 today, qint64 soon) const
+{
+    const qint64 expiry = m_expiryDays.at(index);
+    if (expiry < today) return ExpiredStatus;
+    if (m_quantities.at(index) < LowStockThreshold) return LowStockStatus;
+    if (expiry < soon) return ExpiringSoonStatus;
+    return NormalStatus;
+}
+
+QVariantList StockStore::rowData(int index) const
+{
+    return {m_ids.at(index), m_names.at(index), m_batches.at(index),
+            expiryText(index), m_quantities.at(index), price(index)};
+}
@@ -0,0 +1,80 @@
+#ifndef STOCKSTORE_H
+#define STOCKSTORE_H
+
+#include <QVector>
+#include <QString>
+#include <QHash>
+#include <QDate>
+#include <QVariant>
+
+// Column-oriented in-memory copy of the Medicines table.
+// Each field lives in its own contiguous vector so the stock grid can read a
+// single cell without materialising a whole row. Expiry dates are Julian day
+// numbers and prices integer cents, exactly as stored in the database.
+class StockStore
+{
+public:
+    enum Column {
+        IdColumn = 0,
+        NameColumn,
+        BatchColumn,
+        ExpiryColumn,
+        QuantityColumn,
+        PriceColumn,
+        ColumnCount
+    };
+
+    enum Status {
+        NormalStatus = 0,
+        ExpiringSoonStatus,
+        LowStockStatus,
+        ExpiredStatus
+    };
+
+    static constexpr int LowStockThreshold = 10;
+    static constexpr int ExpiringSoonMonths = 3;
+
+    int size() const { return m_ids.size(); }
+    void clear();
+    void reserve(int count);
+
+    // Appends a medicine and returns its store index. A missing expiry is
+    // QDate().toJulianDay(), which sorts first.
+    int append(int id, const QString& name, const QString& batchNumber, qint64 expiryDay, int quantity, qint64 priceCents);
+    // Overwrites the medicine if it is loaded, appends it otherwise; returns its store index
+    int upsert(int id, const QString& name, const QString& batchNumber, qint64 expiryDay, int quantity, qint64 priceCents);
+    // Drops a medicine from the ID lookup. The slot is left as a tombstone until the next clear()
+    // so that store indices held by the model stay valid.
+    void remove(int index);
+
+    // Returns the store index for a medicine ID, or -1 if it is not loaded
+    int indexOfId(int id) const { return m_indexById.value(id, -1); }
+
+    bool isRemoved(int index) const { return m_ids.at(index) < 0; }
+    int id(int index) const { return m_ids.at(index); }
+    const QString& name(int index) const { return m_names.at(index); }
+    const QString& batchNumber(int index) const { return m_batches.at(index); }
+    qint64 expiryDay(int index) const { return m_expiryDays.at(index); }
+    QDate expiryDate(int index) const { return QDate::fromJulianDay(m_expiryDays.at(index)); }
+    QString expiryText(int index) const;
+    int quantity(int index) const { return m_quantities.at(index); }
+    qint64 priceCents(int index) const { return m_priceCents.at(index); }
+    double price(int index) const { return m_priceCents.at(index) / 100.0; }
+
+    // Row colour classification; today/soon are Julian day numbers
+    Status status(int index, qint64 today, qint64 soon) const;
+
+    // Returns the row in the same layout as DatabaseManager::getAllMedicines()
+    QVariantList rowData(int index) const;
+
+private:
+    QVector<int> m_ids;
+    QVector<QString> m_names;
+    QVector<QString> m_batches;
+    QVector<qint64> m_expiryDays;
+    QVector<int> m_quantities;
+    QVector<qint64> m_priceCents;
+    QHash<int, int> m_indexById;
+};
+
+#endif // STOCKSTORE_H
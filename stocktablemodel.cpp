@@ -0,0 +1,336 @@
+#include "stocktablemodel.h"
+#include "money.h"
+#include <QColor>
+#include <QBrush>
+#include <algorithm>
+#include <numeric>
+
+StockTableModel::StockTableModel(StockStore *store, QObject *parent)
+    : QAbstractTableModel(parent), m_store(store), m_filterActive(false), m_pendingIndex(-1), m_pendingRow(-1), m_sortColumn(-1),
+      m_sortOrder(Qt::AscendingOrder), m_today(0), m_expiringSoon(0)
+{
+    refreshDateWindow();
+}
+
+int StockTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int StockTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : StockStore::ColumnCount;
+}
+
+QVariant StockTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) return QVariant();
+    const int i = m_rows.at(index.row());
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+        case StockStore::IdColumn: return m_store->id(i);
+        case StockStore::NameColumn: return m_store->name(i);
+        case StockStore::BatchColumn: return m_store->batchNumber(i);
+        case StockStore::ExpiryColumn: return m_store->expiryText(i);
+        case StockStore::QuantityColumn: return m_store->quantity(i);
+        case StockStore::PriceColumn: return Money::format(m_store->priceCents(i));
+        default: return QVariant();
+        }
+    }
+    if (role == StatusRole) {
+        return static_cast<int>(m_store->status(i, m_today, m_expiringSoon));
+    }
+    return QVariant();
+}
+
+QVariant StockTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    static const QStringList headers = {"ID", "Medicine Name", "Batch", "Expiry", "Qty", "Price"};
+    return headers.value(section);
+}
+
+Qt::ItemFlags StockTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    // The grid is read-only; edits go through AddMedicineDialog
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+void StockTableModel::sort(int column, Qt::SortOrder order)
+{
+    m_sortColumn = column;
+    m_sortOrder = order;
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    // Remember which medicine every persistent index (e.g. the selection) points at
+    const QModelIndexList oldPersistent = persistentIndexList();
+    QVector<int> persistentStoreRows;
+    persistentStoreRows.reserve(oldPersistent.size());
+    for (const QModelIndex &index : oldPersistent) {
+        persistentStoreRows.append(m_rows.at(index.row()));
+    }
+
+    applySort();
+    rebuildVisibleRows();
+
+    if (!oldPersistent.isEmpty()) {
+        QModelIndexList newPersistent;
+        newPersistent.reserve(oldPersistent.size());
+        for (int k = 0; k < oldPersistent.size(); ++k) {
+            newPersistent.append(index(rowForStoreIndex(persistentStoreRows.at(k)), oldPersistent.at(k).column()));
+        }
+        changePersistentIndexList(oldPersistent, newPersistent);
+    }
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void StockTableModel::reload()
+{
+    beginResetModel();
+    refreshDateWindow();
+    m_allRows.resize(m_store->size());
+    std::iota(m_allRows.begin(), m_allRows.end(), 0);
+    // Already in load order; only a chosen sort column needs the O(n log n) pass
+    if (m_sortColumn >= 0) applySort();
+    m_filterActive = false;
+    m_inFilter.clear();
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+void StockTableModel::setFilter(const QVector<int>& storeIndexes)
+{
+    beginResetModel();
+    m_filterActive = true;
+    m_inFilter.fill(false, m_store->size());
+    for (int i : storeIndexes) m_inFilter.setBit(i);
+
+    if (storeIndexes.size() < m_allRows.size() / 16) {
+        // Few matches: sorting them is cheaper than walking every row
+        m_rows = storeIndexes;
+        std::sort(m_rows.begin(), m_rows.end(), [this](int a, int b) { return lessThan(a, b); });
+    } else {
+        rebuildVisibleRows();
+    }
+    endResetModel();
+}
+
+void StockTableModel::clearFilter()
+{
+    if (!m_filterActive) return;
+    beginResetModel();
+    m_filterActive = false;
+    m_inFilter.clear();
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+int StockTableModel::storeIndex(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) return -1;
+    return m_rows.at(row);
+}
+
+int StockTableModel::rowForStoreIndex(int storeIndex) const
+{
+    if (storeIndex < 0 || storeIndex >= m_store->size()) return -1;
+    return findSorted(m_rows, storeIndex);
+}
+
+void StockTableModel::insertStoreIndex(int storeIndex, bool matchesFilter)
+{
+    m_allRows.insert(sortedPosition(m_allRows, storeIndex), storeIndex);
+    if (!m_filterActive) {
+        insertVisibleRow(storeIndex);
+        return;
+    }
+    m_inFilter.resize(m_store->size());
+    m_inFilter.setBit(storeIndex, matchesFilter);
+    if (matchesFilter) insertVisibleRow(storeIndex);
+}
+
+void StockTableModel::aboutToUpdateStoreIndex(int storeIndex)
+{
+    // Found by the old sort key while every row is still in place
+    m_pendingIndex = -1;
+    m_pendingRow = -1;
+    const int position = findSorted(m_allRows, storeIndex);
+    if (position < 0) return;
+    m_allRows.remove(position);
+    m_pendingIndex = storeIndex;
+    m_pendingRow = findSorted(m_rows, storeIndex);
+}
+
+void StockTableModel::updateStoreIndex(int storeIndex, bool matchesFilter)
+{
+    if (storeIndex != m_pendingIndex) return;
+    const int row = m_pendingRow;
+    m_pendingIndex = -1;
+    m_pendingRow = -1;
+
+    // The sort key may have changed; every other row is still in order
+    m_allRows.insert(sortedPosition(m_allRows, storeIndex), storeIndex);
+
+    const bool visible = !m_filterActive || matchesFilter;
+    if (m_filterActive) m_inFilter.setBit(storeIndex, matchesFilter);
+
+    if (row >= 0 && visible) {
+        moveVisibleRow(row);
+    } else if (row >= 0) {
+        removeVisibleRow(row);
+    } else if (visible) {
+        insertVisibleRow(storeIndex);
+    }
+}
+
+void StockTableModel::removeStoreIndex(int storeIndex)
+{
+    const int position = findSorted(m_allRows, storeIndex);
+    if (position >= 0) m_allRows.remove(position);
+    if (m_filterActive) m_inFilter.clearBit(storeIndex);
+
+    const int row = rowForStoreIndex(storeIndex);
+    if (row >= 0) removeVisibleRow(row);
+}
+
+void StockTableModel::removeVisibleRow(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.remove(row);
+    endRemoveRows();
+}
+
+void StockTableModel::insertVisibleRow(int storeIndex)
+{
+    const int row = sortedPosition(m_rows, storeIndex);
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.insert(row, storeIndex);
+    endInsertRows();
+}
+
+void StockTableModel::moveVisibleRow(int row)
+{
+    const int storeIndex = m_rows.at(row);
+
+    // Position the row would take among the other rows if its sort key changed
+    const auto first = m_rows.cbegin();
+    const auto last = m_rows.cend();
+    int target = int(std::upper_bound(first, first + row, storeIndex,
+                                      [this](int a, int b) { return lessThan(a, b); }) - first);
+    if (target == row) {
+        target = row + int(std::upper_bound(first + row + 1, last, storeIndex,
+                                            [this](int a, int b) { return lessThan(a, b); }) - (first + row + 1));
+    }
+
+    if (target != row) {
+        // beginMoveRows expects the destination in pre-move coordinates
+        const int destination = target > row ? target + 1 : target;
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination);
+        m_rows.remove(row);
+        m_rows.insert(target, storeIndex);
+        endMoveRows();
+    }
+
+    emit dataChanged(index(target, 0), index(target, StockStore::ColumnCount - 1));
+}
+
+void StockTableModel::rollDateWindow()
+{
+    refreshDateWindow();
+    if (m_rows.isEmpty()) return;
+    emit dataChanged(index(0, 0), index(m_rows.size() - 1, StockStore::ColumnCount - 1), {StatusRole});
+}
+
+void StockTableModel::refreshDateWindow()
+{
+    const QDate today = QDate::currentDate();
+    m_today = today.toJulianDay();
+    m_expiringSoon = today.addMonths(StockStore::ExpiringSoonMonths).toJulianDay();
+}
+
+void StockTableModel::applySort()
+{
+    if (m_sortColumn < 0) {
+        // No sort column: fall back to load order
+        std::sort(m_allRows.begin(), m_allRows.end());
+        return;
+    }
+    std::sort(m_allRows.begin(), m_allRows.end(), [this](int a, int b) { return lessThan(a, b); });
+}
+
+void StockTableModel::rebuildVisibleRows()
+{
+    if (!m_filterActive) {
+        m_rows = m_allRows;
+    } else {
+        m_rows.clear();
+        for (int i : m_allRows) {
+            if (m_inFilter.testBit(i)) m_rows.append(i);
+        }
+    }
+}
+
+bool StockTableModel::lessThan(int a, int b) const
+{
+    if (m_sortColumn >= 0 && m_sortOrder == Qt::DescendingOrder) std::swap(a, b);
+
+    // -1, 0 or 1 by the sort column; ties fall back to load order
+    auto compare = [](const auto& x, const auto& y) { return x < y ? -1 : (y < x ? 1 : 0); };
+    const StockStore *s = m_store;
+    int order = 0;
+    switch (m_sortColumn) {
+    case StockStore::IdColumn: order = compare(s->id(a), s->id(b)); break;
+    case StockStore::NameColumn: order = s->name(a).compare(s->name(b)); break;
+    case StockStore::BatchColumn: order = s->batchNumber(a).compare(s->batchNumber(b)); break;
+    case StockStore::ExpiryColumn: order = compare(s->expiryDay(a), s->expiryDay(b)); break;
+    case StockStore::QuantityColumn: order = compare(s->quantity(a), s->quantity(b)); break;
+    case StockStore::PriceColumn: order = compare(s->priceCents(a), s->priceCents(b)); break;
+    default: break;
+    }
+    return order != 0 ? order < 0 : a < b;
+}
+
+int StockTableModel::sortedPosition(const QVector<int>& rows, int storeIndex) const
+{
+    return int(std::upper_bound(rows.cbegin(), rows.cend(), storeIndex,
+                                [this](int a, int b) { return lessThan(a, b); }) - rows.cbegin());
+}
+
+int StockTableModel::findSorted(const QVector<int>& rows, int storeIndex) const
+{
+    auto it = std::lower_bound(rows.cbegin(), rows.cend(), storeIndex,
+                               [this](int a, int b) { return lessThan(a, b); });
+    return it != rows.cend() && *it == storeIndex ? int(it - rows.cbegin()) : -1;
+}
+
+
+// StockRowDelegate Implementation
+StockRowDelegate::StockRowDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void StockRowDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+
+    switch (index.data(StockTableModel::StatusRole).toInt()) {
+    case StockStore::ExpiredStatus:
+        option->backgroundBrush = QColor(229, 62, 62, 50);
+        break;
+    case StockStore::LowStockStatus:
+        option->backgroundBrush = QColor(246, 173, 85, 50);
+        break;
+    case StockStore::ExpiringSoonStatus:
+        option->backgroundBrush = QColor(236, 201, 75, 50);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef STOCKTABLEMODEL_H
+#define STOCKTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStyledItemDelegate>
+#include <QVector>
+#include <QBitArray>
+#include "stockstore.h"
+
+// Read-only table model over a StockStore. Cells are produced on demand from
+// the columnar store, so the view only pays for the rows it actually paints.
+class StockTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    // Returns StockStore::Status for a row; used by StockRowDelegate
+    static constexpr int StatusRole = Qt::UserRole + 1;
+
+    explicit StockTableModel(StockStore *store, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    // Call after the underlying store has been refilled; also clears the filter.
+    // Linear in the store size unless a sort column is set.
+    void reload();
+    // Moves the expired / expiring-soon window to today and repaints every
+    // row's status; for the midnight rollover, when no medicine changed
+    void rollDateWindow();
+
+    // Shows only the given store indices (in the current sort order) with a
+    // single model reset, rather than hiding rows one by one in the view
+    void setFilter(const QVector<int>& storeIndexes);
+    void clearFilter();
+    bool isFiltered() const { return m_filterActive; }
+
+    // Maps a view row to its index in the StockStore (-1 if out of range)
+    int storeIndex(int row) const;
+    // Maps a store index to its view row (-1 if it is not shown)
+    int rowForStoreIndex(int storeIndex) const;
+
+    // Row-level updates. Each touches only the affected row, keeping it in
+    // sorted position with binary searches. matchesFilter says whether the row
+    // passes the active filter and is ignored when none is set.
+    //
+    // Rows are found by their sort key, so a changed row must be announced
+    // with aboutToUpdateStoreIndex() before the store is written, and rows
+    // must be changed one at a time:
+    //     model->aboutToUpdateStoreIndex(i);  store.upsert(...);  model->updateStoreIndex(i, match);
+    // removeStoreIndex() likewise comes before StockStore::remove(), and
+    // insertStoreIndex() after the row was appended.
+    void insertStoreIndex(int storeIndex, bool matchesFilter = true);
+    void aboutToUpdateStoreIndex(int storeIndex);
+    void updateStoreIndex(int storeIndex, bool matchesFilter = true);
+    void removeStoreIndex(int storeIndex);
+
+private:
+    void refreshDateWindow();
+    void applySort();
+    void rebuildVisibleRows();
+    // Total order: rows with equal sort keys are ordered by store index
+    bool lessThan(int a, int b) const;
+    int sortedPosition(const QVector<int>& rows, int storeIndex) const;
+    // Position of storeIndex in the sorted rows, or -1
+    int findSorted(const QVector<int>& rows, int storeIndex) const;
+    void removeVisibleRow(int row);
+    void insertVisibleRow(int storeIndex);
+    void moveVisibleRow(int row);
+
+    StockStore *m_store;
+    QVector<int> m_allRows;  // every loaded medicine, in sort order
+    QVector<int> m_rows;     // view row -> store index (m_allRows minus filtered-out rows)
+    bool m_filterActive;
+    QBitArray m_inFilter;    // by store index, valid while m_filterActive
+    int m_pendingIndex;      // announced by aboutToUpdateStoreIndex(), out of m_allRows
+    int m_pendingRow;        // its view row then, or -1
+    int m_sortColumn;
+    Qt::SortOrder m_sortOrder;
+    qint64 m_today;          // Julian day numbers for row colouring
+    qint64 m_expiringSoon;
+};
+
+// Paints the stock status colour behind each cell at draw time instead of
+// storing a background brush per item.
+class StockRowDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit StockRowDelegate(QObject *parent = nullptr);
+
+protected:
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+};
+
+#endif // STOCKTABLEMODEL_H
@@ -0,0 +1,72 @@
+# Qt Test benchmarks (QBENCHMARK) for the widget hot paths: main window load,
+# stock search and sales history paging on the offscreen platform against a
+# database from tools/common/benchsupport, plus the in-memory helpers behind
+# them. Run ./benchtests, or add a case name such as "searchFuzzy". Gates on
+# a baseline only when BENCHTESTS_BASELINE names one (see tst_hotpaths.cpp).
+QT       += core gui sql widgets network concurrent testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../.. ../common
+
+SOURCES += \
+    tst_hotpaths.cpp \
+    ../common/benchsupport.cpp \
+    ../../addmedicinedialog.cpp \
+    ../../asyncdatabase.cpp \
+    ../../catalogimporter.cpp \
+    ../../columnarfile.cpp \
+    ../../copilotcache.cpp \
+    ../../databasemanager.cpp \
+    ../../databaseprofile.cpp \
+    ../../dataexporter.cpp \
+    ../../diagnosticsdialog.cpp \
+    ../../fuzzymedicinelookup.cpp \
+    ../../goodsreceiptdialog.cpp \
+    ../../goodsreceiptmodel.cpp \
+    ../../inventorykpis.cpp \
+    ../../invoicedetailscache.cpp \
+    ../../invoicelistmodel.cpp \
+    ../../mainwindow.cpp \
+    ../../medicineretrieval.cpp \
+    ../../metrics.cpp \
+    ../../modernwidgets.cpp \
+    ../../saleshistorydialog.cpp \
+    ../../schemamigrations.cpp \
+    ../../stocksearchindex.cpp \
+    ../../stockstore.cpp \
+    ../../stocktablemodel.cpp \
+    ../../tracing.cpp
+
+HEADERS += \
+    ../common/benchsupport.h \
+    ../../addmedicinedialog.h \
+    ../../asyncdatabase.h \
+    ../../catalogimporter.h \
+    ../../columnarfile.h \
+    ../../copilotcache.h \
+    ../../databasemanager.h \
+    ../../databaseprofile.h \
+    ../../dataexporter.h \
+    ../../diagnosticsdialog.h \
+    ../../fuzzymedicinelookup.h \
+    ../../goodsreceiptdialog.h \
+    ../../goodsreceiptmodel.h \
+    ../../inventorykpis.h \
+    ../../invoicedetailscache.h \
+    ../../invoicelistmodel.h \
+    ../../mainwindow.h \
+    ../../medicineretrieval.h \
+    ../../metrics.h \
+    ../../modernwidgets.h \
+    ../../money.h \
+    ../../saleshistorydialog.h \
+    ../../schemamigrations.h \
+    ../../stocksearchindex.h \
+    ../../stockstore.h \
+    ../../stocktablemodel.h \
+    ../../tracing.h
+
+RESOURCES += \
+    ../../resources.qrc
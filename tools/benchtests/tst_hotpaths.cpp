@@ -0,0 +1,388 @@
+#include "benchsupport.h"
+#include "asyncdatabase.h"
+#include "databasemanager.h"
+#include "fuzzymedicinelookup.h"
+#include "inventorykpis.h"
+#include "invoicedetailscache.h"
+#include "invoicelistmodel.h"
+#include "mainwindow.h"
+#include "saleshistorydialog.h"
+#include "stocksearchindex.h"
+#include "stockstore.h"
+#include "stocktablemodel.h"
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QtTest>
+#include <functional>
+#include <memory>
+
+namespace {
+
+constexpr int WaitTimeoutMs = 30000;
+
+int environmentInt(const char *name, int fallback)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok ? value : fallback;
+}
+
+// Spins the event loop until signal has fired and done() holds, or the timeout
+template <typename Sender, typename Signal>
+bool waitFor(Sender *sender, Signal signal, const std::function<bool()>& done)
+{
+    if (done()) return true;
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QObject::connect(sender, signal, &loop, [&loop, &done]() {
+        if (done()) loop.quit();
+    });
+    timeout.start(WaitTimeoutMs);
+    loop.exec();
+    return done();
+}
+
+}
+
+// The widget hot paths, driven offscreen against a generated database:
+// main window load, stock search, sales history paging, plus the in-memory
+// helpers behind them (KPI counts, sorting, fuzzy lookup, cart total).
+//
+// QBENCHMARK reports every case. The mean per call is also checked against
+// a stored baseline, but only when one is given; none is checked in because
+// a baseline is only meaningful on the machine that recorded it.
+//   BENCHTESTS_SKUS, BENCHTESTS_INVOICES   generated sizes (5000, 20000)
+//   BENCHTESTS_BASELINE                    JSON file of mean_us per case; fails past the threshold
+//   BENCHTESTS_THRESHOLD                   allowed ratio over the baseline (1.25)
+//   BENCHTESTS_WRITE_BASELINE              records this run's means there
+class HotPaths : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void mainWindowOpen();
+    void searchSubstring();
+    void searchShort();
+    void searchFuzzy();
+    void searchClear();
+    void salesHistoryOpen();
+    void salesHistoryNextPage();
+
+    void stockSearch_data();
+    void stockSearch();
+    void fuzzyLookup();
+    void stockSort_data();
+    void stockSort();
+    void kpisReset();
+    void cartTotal_data();
+    void cartTotal();
+
+private:
+    // Times fn under QBENCHMARK and checks its mean against the baseline
+    void benchmark(const QString& operation, const std::function<void()>& fn);
+    std::unique_ptr<MainWindow> openMainWindow();
+    void typed(const QString& text);
+
+    QTemporaryDir m_scratch;
+    QString m_databasePath;
+    Bench::DataConfig m_config;
+    QRandomGenerator m_random;
+
+    QHash<QString, double> m_baseline;  // operation -> mean in microseconds
+    QHash<QString, double> m_results;
+    double m_threshold = 1.25;
+
+    std::unique_ptr<MainWindow> m_window;
+    QLineEdit *m_search = nullptr;
+    StockTableModel *m_stockModel = nullptr;
+
+    // What the main window holds in memory, for the dialog and the helper cases
+    StockStore m_store;
+    StockSearchIndex m_searchIndex;
+    FuzzyMedicineLookup m_fuzzyLookup;
+};
+
+void HotPaths::initTestCase()
+{
+    m_config.skus = qMax(1, environmentInt("BENCHTESTS_SKUS", m_config.skus));
+    m_config.invoices = qMax(InvoiceListModel::PageSize * 3, environmentInt("BENCHTESTS_INVOICES", m_config.invoices));
+    m_random.seed(m_config.seed);
+
+    const QString baselinePath = qEnvironmentVariable("BENCHTESTS_BASELINE");
+    if (!baselinePath.isEmpty()) {
+        QFile file(baselinePath);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable("Cannot read baseline " + baselinePath));
+        const QJsonObject means = QJsonDocument::fromJson(file.readAll()).object().value("mean_us").toObject();
+        for (auto it = means.constBegin(); it != means.constEnd(); ++it) m_baseline.insert(it.key(), it.value().toDouble());
+        m_threshold = qEnvironmentVariable("BENCHTESTS_THRESHOLD", "1.25").toDouble();
+    }
+
+    // The main window opens database/medicare.db relative to the working directory
+    QVERIFY(m_scratch.isValid());
+    QVERIFY(QDir::setCurrent(m_scratch.path()));
+    m_databasePath = QDir(m_scratch.path()).absoluteFilePath("database/medicare.db");
+    {
+        DatabaseManager db("benchtests-seed", m_databasePath);
+        QVERIFY(db.initDatabase());
+        QVERIFY(Bench::generateDatabase(db, m_config, m_random));
+        QVERIFY(db.loadMedicines(m_store));
+    }
+    QSqlDatabase::removeDatabase("benchtests-seed");
+    m_searchIndex.rebuild(m_store);
+    m_fuzzyLookup.rebuild(m_store);
+}
+
+void HotPaths::cleanupTestCase()
+{
+    m_window.reset();
+    const QString writePath = qEnvironmentVariable("BENCHTESTS_WRITE_BASELINE");
+    if (writePath.isEmpty()) return;
+
+    QJsonObject means;
+    for (auto it = m_results.cbegin(); it != m_results.cend(); ++it) means.insert(it.key(), it.value());
+    QSaveFile file(writePath);
+    QVERIFY2(file.open(QIODevice::WriteOnly), qPrintable("Cannot write baseline " + writePath));
+    file.write(QJsonDocument(QJsonObject{{"mean_us", means}}).toJson());
+    QVERIFY(file.commit());
+}
+
+void HotPaths::benchmark(const QString& operation, const std::function<void()>& fn)
+{
+    qint64 calls = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        fn();
+        ++calls;
+    }
+    const double meanUs = timer.nsecsElapsed() / 1000.0 / qMax<qint64>(1, calls);
+    m_results.insert(operation, meanUs);
+
+    auto expected = m_baseline.constFind(operation);
+    if (expected != m_baseline.constEnd() && meanUs > expected.value() * m_threshold) {
+        QFAIL(qPrintable(QString("%1 regressed: %2 us per call, baseline %3 us")
+                             .arg(operation).arg(meanUs, 0, 'f', 1).arg(expected.value(), 0, 'f', 1)));
+    }
+}
+
+std::unique_ptr<MainWindow> HotPaths::openMainWindow()
+{
+    // The window loads the stock on its database worker; done once the grid is full
+    auto window = std::make_unique<MainWindow>();
+    window->show();
+    StockTableModel *model = window->findChild<StockTableModel *>();
+    const int skus = m_config.skus;
+    if (!model || !waitFor(model, &QAbstractItemModel::modelReset, [model, skus]() { return model->rowCount() >= skus; })) {
+        return nullptr;
+    }
+    return window;
+}
+
+void HotPaths::typed(const QString& text)
+{
+    // Every call changes the text, as typing does; an unchanged text emits nothing
+    if (m_search->text() == text) m_search->clear();
+    m_search->setText(text);
+}
+
+void HotPaths::mainWindowOpen()
+{
+    bool opened = true;
+    benchmark("mainWindow.open", [this, &opened]() {
+        std::unique_ptr<MainWindow> window = openMainWindow();
+        opened = opened && window != nullptr;
+        window.reset();
+    });
+    QVERIFY(opened);
+
+    // The search and sales history cases share one window
+    m_window = openMainWindow();
+    QVERIFY(m_window);
+    m_search = m_window->findChild<QLineEdit *>("stockSearch");
+    m_stockModel = m_window->findChild<StockTableModel *>();
+    QVERIFY(m_search && m_stockModel);
+}
+
+void HotPaths::searchSubstring()
+{
+    QVERIFY(m_search);
+    benchmark("search.substring", [this]() { typed(QString("Medicine %1").arg(m_random.bounded(1, m_config.skus + 1))); });
+    QVERIFY(m_stockModel->rowCount() > 0);
+}
+
+void HotPaths::searchShort()
+{
+    QVERIFY(m_search);
+    bool flip = false;
+    benchmark("search.short", [this, &flip]() { typed((flip = !flip) ? "Me" : "Med"); });
+    QVERIFY(m_stockModel->rowCount() > 0);
+}
+
+void HotPaths::searchFuzzy()
+{
+    QVERIFY(m_search);
+    // No name contains the misspelling, so the closest spellings are shown instead
+    benchmark("search.fuzzy", [this]() { typed(QString("Medecine %1").arg(m_random.bounded(1, m_config.skus + 1))); });
+    QVERIFY(m_stockModel->rowCount() > 0);
+}
+
+void HotPaths::searchClear()
+{
+    QVERIFY(m_search);
+    // Half the calls narrow the grid, half restore every row
+    bool narrow = false;
+    benchmark("search.clear", [this, &narrow]() {
+        if ((narrow = !narrow)) typed("Medicine 1");
+        else m_search->clear();
+    });
+    m_search->clear();
+    QCOMPARE(m_stockModel->rowCount(), m_config.skus);
+}
+
+void HotPaths::salesHistoryOpen()
+{
+    QVERIFY(m_window);
+    AsyncDatabase database(m_databasePath);
+    InvoiceDetailsCache detailsCache(&database, InvoiceDetailsCache::DefaultCapacity);
+    bool loaded = true;
+    benchmark("salesHistory.open", [&]() {
+        SalesHistoryDialog dialog(&database, &detailsCache, &m_store, &m_searchIndex, m_window.get());
+        dialog.show();
+        InvoiceListModel *model = dialog.findChild<InvoiceListModel *>();
+        loaded = loaded && model
+                 && waitFor(model, &InvoiceListModel::pageLoaded, [model]() { return model->rowCount() > 0; });
+    });
+    QVERIFY(loaded);
+}
+
+void HotPaths::salesHistoryNextPage()
+{
+    QVERIFY(m_window);
+    AsyncDatabase database(m_databasePath);
+    InvoiceDetailsCache detailsCache(&database, InvoiceDetailsCache::DefaultCapacity);
+    SalesHistoryDialog dialog(&database, &detailsCache, &m_store, &m_searchIndex, m_window.get());
+    dialog.show();
+    InvoiceListModel *model = dialog.findChild<InvoiceListModel *>();
+    QVERIFY(model);
+    auto firstPage = [model]() {
+        return waitFor(model, &InvoiceListModel::pageLoaded, [model]() { return model->rowCount() > 0; });
+    };
+    QVERIFY(firstPage());
+
+    bool loaded = true;
+    benchmark("salesHistory.nextPage", [&]() {
+        // Past the last page, start over; rare next to the page fetches
+        if (!model->canFetchMore(QModelIndex())) {
+            model->refresh();
+            loaded = loaded && firstPage();
+            return;
+        }
+        const int rows = model->rowCount();
+        model->fetchMore(QModelIndex());
+        loaded = loaded && waitFor(model, &InvoiceListModel::pageLoaded, [model, rows]() { return model->rowCount() > rows; });
+    });
+    QVERIFY(loaded);
+}
+
+void HotPaths::stockSearch_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::newRow("substring") << "Medicine 1234";
+    QTest::newRow("short") << "Me";
+    QTest::newRow("batch") << "BENCH-0000999";
+}
+
+void HotPaths::stockSearch()
+{
+    QFETCH(QString, text);
+    QVector<int> matches;
+    benchmark(QString("stockSearch.%1").arg(QTest::currentDataTag()), [&]() { matches = m_searchIndex.search(text); });
+    QVERIFY(!matches.isEmpty());
+}
+
+void HotPaths::fuzzyLookup()
+{
+    QVector<FuzzyMedicineLookup::Match> matches;
+    benchmark("fuzzyLookup", [this, &matches]() { matches = m_fuzzyLookup.lookup("Medecine 1234", 50); });
+    QVERIFY(!matches.isEmpty());
+}
+
+void HotPaths::stockSort_data()
+{
+    QTest::addColumn<int>("column");
+    QTest::newRow("name") << int(StockStore::NameColumn);
+    QTest::newRow("quantity") << int(StockStore::QuantityColumn);
+    QTest::newRow("expiry") << int(StockStore::ExpiryColumn);
+}
+
+void HotPaths::stockSort()
+{
+    QFETCH(int, column);
+    StockTableModel model(&m_store);
+    model.reload();
+    Qt::SortOrder order = Qt::AscendingOrder;
+    benchmark(QString("stockModel.sort.%1").arg(QTest::currentDataTag()), [&]() {
+        model.sort(column, order);
+        order = order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+    });
+    QCOMPARE(model.rowCount(), m_store.size());
+}
+
+void HotPaths::kpisReset()
+{
+    InventoryKpis kpis;
+    benchmark("inventoryKpis.reset", [this, &kpis]() { kpis.reset(m_store); });
+    QCOMPARE(kpis.totalMedicines(), m_store.size());
+}
+
+void HotPaths::cartTotal_data()
+{
+    QTest::addColumn<int>("lines");
+    QTest::newRow("10 lines") << 10;
+    QTest::newRow("200 lines") << 200;
+}
+
+void HotPaths::cartTotal()
+{
+    // The total label is recomputed from the whole cart after every added line
+    QFETCH(int, lines);
+    QListWidget cart;
+    qint64 expectedCents = 0;
+    for (int i = 0; i < lines; ++i) {
+        QListWidgetItem *item = new QListWidgetItem(QString("Line %1").arg(i + 1), &cart);
+        item->setData(Qt::UserRole + 1, qint64(199 + i));
+        expectedCents += 199 + i;
+    }
+    qint64 totalCents = 0;
+    benchmark(QString("cart.total.%1").arg(lines), [&cart, &totalCents]() { totalCents = MainWindow::cartTotalCents(&cart); });
+    QCOMPARE(totalCents, expectedCents);
+}
+
+int main(int argc, char *argv[])
+{
+    // No display is needed; an explicit QT_QPA_PLATFORM still wins
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QTEST_SET_MAIN_SOURCE_PATH
+    HotPaths test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_hotpaths.moc"
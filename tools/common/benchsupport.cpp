@@ -0,0 +1,156 @@
+#include "benchsupport.h"
+#include "databasemanager.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+QtMessageHandler previousHandler = nullptr;
+
+// qDebug() lines from the code under test would be timed as console I/O.
+// Failures still show up in the result's failure count.
+void dropDebugMessages(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    if (type == QtDebugMsg) return;
+    if (previousHandler) {
+        previousHandler(type, context, message);
+    } else {
+        std::fprintf(stderr, "%s\n", qPrintable(qFormatLogMessage(type, context, message)));
+    }
+}
+
+}
+
+bool Bench::generateDatabase(DatabaseManager& db, const DataConfig& config, QRandomGenerator& random)
+{
+    QList<MedicineRecord> records;
+    records.reserve(config.skus);
+    const QDate today = QDate::currentDate();
+    for (int i = 1; i <= config.skus; ++i) {
+        MedicineRecord record;
+        record.name = QString("Medicine %1 %2mg").arg(i).arg(5 * random.bounded(1, 200));
+        record.batchNumber = QString("BENCH-%1").arg(i, 7, 10, QChar('0'));
+        record.expiry = today.addDays(random.bounded(-60, 3 * 365));
+        // Enough stock that timed checkouts never run short
+        record.quantity = 10000000;
+        record.priceCents = random.bounded(50, 50000);
+        records.append(record);
+    }
+    if (!db.importMedicines(records, DatabaseManager::SkipDuplicates).ok) return false;
+
+    // Invoices are inserted directly in one transaction: createInvoice per
+    // generated sale would make seeding the slowest part of the run.
+    QSqlDatabase connection = QSqlDatabase::database(db.connectionName());
+    if (!connection.transaction()) return false;
+    QSqlQuery invoiceQuery(connection);
+    QSqlQuery itemQuery(connection);
+    invoiceQuery.prepare("INSERT INTO Invoices (saleDate, totalCents) VALUES (?, ?)");
+    itemQuery.prepare("INSERT INTO InvoiceItems (invoiceId, medicineId, quantitySold, priceAtSaleCents) VALUES (?, ?, ?, ?)");
+    const QDateTime start = QDateTime(today.addDays(-365), QTime(8, 0));
+    for (int i = 0; i < config.invoices; ++i) {
+        // Sales in time order, as a real history would be
+        const QDateTime saleTime = start.addSecs(qint64(i) * 365 * 86400 / qMax(1, config.invoices));
+        const int lines = random.bounded(1, 2 * config.cartLines);
+        QList<QPair<int, int>> items;
+        qint64 totalCents = 0;
+        for (int line = 0; line < lines; ++line) {
+            const int medicineId = random.bounded(1, config.skus + 1);
+            const int quantity = random.bounded(1, 5);
+            items.append({medicineId, quantity});
+            totalCents += quantity * records.at(medicineId - 1).priceCents;
+        }
+        invoiceQuery.bindValue(0, saleTime.toString(Qt::ISODate));
+        invoiceQuery.bindValue(1, totalCents);
+        if (!invoiceQuery.exec()) {
+            qDebug() << "Seeding invoices failed:" << invoiceQuery.lastError().text();
+            connection.rollback();
+            return false;
+        }
+        const qint64 invoiceId = invoiceQuery.lastInsertId().toLongLong();
+        for (const auto& item : items) {
+            itemQuery.bindValue(0, invoiceId);
+            itemQuery.bindValue(1, item.first);
+            itemQuery.bindValue(2, item.second);
+            itemQuery.bindValue(3, records.at(item.first - 1).priceCents);
+            if (!itemQuery.exec()) {
+                qDebug() << "Seeding invoice lines failed:" << itemQuery.lastError().text();
+                connection.rollback();
+                return false;
+            }
+        }
+    }
+    return connection.commit() && db.rebuildSalesRollups();
+}
+
+QList<QPair<int, int>> Bench::randomCart(QRandomGenerator& random, const DataConfig& config)
+{
+    QList<QPair<int, int>> cart;
+    const int lines = random.bounded(1, 2 * config.cartLines);
+    for (int line = 0; line < lines; ++line) cart.append({random.bounded(1, config.skus + 1), random.bounded(1, 5)});
+    return cart;
+}
+
+Bench::Result Bench::measure(const QString& operation, int iterations, const std::function<bool(int)>& fn,
+                             const std::function<void(int)>& setup)
+{
+    Result result;
+    result.operation = operation;
+    result.iterations = iterations;
+
+    QVector<qint64> samples;
+    samples.reserve(iterations);
+    qint64 totalNs = 0;
+    previousHandler = qInstallMessageHandler(dropDebugMessages);
+    for (int i = 0; i < iterations; ++i) {
+        if (setup) setup(i);
+        QElapsedTimer call;
+        call.start();
+        if (!fn(i)) result.failures++;
+        samples.append(call.nsecsElapsed());
+        totalNs += samples.last();
+    }
+    qInstallMessageHandler(previousHandler);
+    if (samples.isEmpty()) return result;
+    std::sort(samples.begin(), samples.end());
+
+    // Nearest-rank percentiles
+    auto percentile = [&samples](double p) {
+        const int rank = qBound(0, int(std::ceil(p * samples.size())) - 1, int(samples.size()) - 1);
+        return samples.at(rank) / 1000.0;
+    };
+    result.p50Us = percentile(0.50);
+    result.p99Us = percentile(0.99);
+    result.maxUs = samples.last() / 1000.0;
+    result.opsPerSecond = totalNs > 0 ? iterations * 1e9 / totalNs : 0.0;
+    return result;
+}
+
+QJsonObject Bench::Result::toJson() const
+{
+    return {
+        {"type", "result"},
+        {"operation", operation},
+        {"iterations", iterations},
+        {"failures", failures},
+        {"p50_us", p50Us},
+        {"p99_us", p99Us},
+        {"max_us", maxUs},
+        {"ops_per_s", opsPerSecond},
+    };
+}
+
+void Bench::printJson(const QJsonObject& object)
+{
+    QTextStream(stdout) << QJsonDocument(object).toJson(QJsonDocument::Compact) << Qt::endl;
+}
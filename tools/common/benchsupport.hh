@@ -0,0 +1,53 @@
+#ifndef BENCHSUPPORT_H
+#define BENCHSUPPORT_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QJsonObject>
+#include <functional>
+
+class DatabaseManager;
+class QRandomGenerator;
+
+// Shared by the benchmark tools: a seeded synthetic database and latency stats
+namespace Bench {
+
+struct DataConfig
+{
+    int skus = 5000;
+    int invoices = 20000;
+    int cartLines = 3;      // average lines per generated invoice and checkout
+    quint32 seed = 42;
+};
+
+struct Result
+{
+    QString operation;
+    int iterations = 0;
+    int failures = 0;
+    double p50Us = 0;
+    double p99Us = 0;
+    double maxUs = 0;
+    double opsPerSecond = 0;
+
+    QJsonObject toJson() const;
+};
+
+// Fills a freshly initialised database. The same seed always produces the
+// same data, so runs can be compared.
+bool generateDatabase(DatabaseManager& db, const DataConfig& config, QRandomGenerator& random);
+QList<QPair<int, int>> randomCart(QRandomGenerator& random, const DataConfig& config);
+
+// Times calls of fn(i) for i in [0, iterations); fn returns false on failure.
+// setup(i), if given, runs untimed before each call. qDebug() output is
+// dropped while measuring.
+Result measure(const QString& operation, int iterations, const std::function<bool(int)>& fn,
+               const std::function<void(int)>& setup = {});
+
+// One compact JSON object per line on stdout
+void printJson(const QJsonObject& object);
+
+}
+
+#endif // BENCHSUPPORT_H
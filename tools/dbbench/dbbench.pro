@@ -0,0 +1,29 @@
+# DatabaseManager micro-benchmarks: builds a deterministic synthetic database
+# and prints per-operation latency percentiles and throughput as JSON lines.
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../.. ../common
+
+SOURCES += \
+    main.cpp \
+    ../common/benchsupport.cpp \
+    ../../databasemanager.cpp \
+    ../../databaseprofile.cpp \
+    ../../metrics.cpp \
+    ../../schemamigrations.cpp \
+    ../../stockstore.cpp \
+    ../../tracing.cpp
+
+HEADERS += \
+    ../common/benchsupport.h \
+    ../../databasemanager.h \
+    ../../databaseprofile.h \
+    ../../metrics.h \
+    ../../money.h \
+    ../../schemamigrations.h \
+    ../../stockstore.h \
+    ../../tracing.h
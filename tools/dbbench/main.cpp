@@ -0,0 +1,184 @@
+#include "benchsupport.h"
+#include "databasemanager.h"
+#include "stockstore.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QVariantList>
+#include <QDebug>
+
+namespace {
+
+// Times fn and prints its result line
+void measure(const QString& operation, int iterations, const std::function<bool(int)>& fn)
+{
+    Bench::printJson(Bench::measure(operation, iterations, fn).toJson());
+}
+
+// Times sql prepared afresh on every call (<operation>.fresh) against one
+// statement prepared up front and reused, as DatabaseManager::cachedQuery()
+// does (<operation>.cached). Writes run in a transaction that is rolled back,
+// so both cases leave the data alone and commits do not hide the difference.
+void measurePrepared(const QString& operation, int iterations, QSqlDatabase connection, const QString& sql,
+                     const std::function<QVariantList()>& bindings)
+{
+    auto run = [&bindings](QSqlQuery& query) {
+        const QVariantList values = bindings();
+        for (int k = 0; k < values.size(); ++k) query.bindValue(k, values.at(k));
+        const bool ok = query.exec();
+        if (ok && query.isSelect()) query.next();
+        query.finish();
+        return ok;
+    };
+
+    connection.transaction();
+    measure(operation + ".fresh", iterations, [&](int) {
+        QSqlQuery query(connection);
+        return query.prepare(sql) && run(query);
+    });
+    QSqlQuery cached(connection);
+    if (!cached.prepare(sql)) qDebug() << "Failed to prepare" << sql;
+    measure(operation + ".cached", iterations, [&](int) { return run(cached); });
+    cached.clear();
+    connection.rollback();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times DatabaseManager operations against a synthetic database. "
+                                     "Prints one JSON object per line: the configuration, then one result per operation.");
+    parser.addHelpOption();
+    QCommandLineOption skusOption("skus", "Medicines in the generated inventory.", "n", "5000");
+    QCommandLineOption invoicesOption("invoices", "Invoices in the generated sales history.", "n", "20000");
+    QCommandLineOption cartOption("cart", "Average lines per invoice.", "n", "3");
+    QCommandLineOption iterationsOption("iterations", "Calls per operation (full scans: a tenth).", "n", "200");
+    QCommandLineOption seedOption("seed", "Random seed for the generated data and workload.", "n", "42");
+    QCommandLineOption profileOption("profile", "Connection profile: " + DatabaseProfile::presetNames().join(", ") + ".",
+                                     "name", DatabaseProfile::durable().name);
+    QCommandLineOption databaseOption("database", "New SQLite file to create (default: a temporary file).", "path");
+    parser.addOptions({skusOption, invoicesOption, cartOption, iterationsOption, seedOption, profileOption, databaseOption});
+    parser.process(app);
+
+    Bench::DataConfig config;
+    config.skus = qMax(1, parser.value(skusOption).toInt());
+    config.invoices = qMax(0, parser.value(invoicesOption).toInt());
+    config.cartLines = qMax(1, parser.value(cartOption).toInt());
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    config.seed = parser.value(seedOption).toUInt();
+    const DatabaseProfile profile = DatabaseProfile::fromName(parser.value(profileOption));
+
+    QTemporaryDir tempDir;
+    const QString databasePath = parser.isSet(databaseOption) ? parser.value(databaseOption)
+                                                              : tempDir.filePath("dbbench.db");
+    if (QFile::exists(databasePath)) {
+        qDebug() << databasePath << "already exists; the benchmark needs a fresh file";
+        return 1;
+    }
+
+    DatabaseManager db("dbbench", databasePath);
+    db.setProfile(profile);
+    if (!db.initDatabase()) return 1;
+
+    QRandomGenerator random(config.seed);
+    QElapsedTimer seedTimer;
+    seedTimer.start();
+    if (!Bench::generateDatabase(db, config, random)) {
+        qDebug() << "Could not generate the benchmark database";
+        return 1;
+    }
+    Bench::printJson({
+        {"type", "config"},
+        {"skus", config.skus},
+        {"invoices", config.invoices},
+        {"cart", config.cartLines},
+        {"iterations", iterations},
+        {"seed", qint64(config.seed)},
+        {"profile", profile.name},
+        {"generate_ms", seedTimer.elapsed()},
+    });
+
+    const int scans = qMax(1, iterations / 10);
+    const QDate today = QDate::currentDate();
+    auto randomInvoiceId = [&random, &config]() { return qint64(random.bounded(1, qMax(1, config.invoices) + 1)); };
+
+    measure("getAllMedicines", scans, [&db](int) { return !db.getAllMedicines().isEmpty(); });
+    measure("loadMedicines", scans, [&db](int) {
+        StockStore store;
+        return db.loadMedicines(store);
+    });
+    measure("getInvoices", scans, [&db, &config](int) { return db.getInvoices().size() >= config.invoices; });
+    measure("getInvoicePage.first", iterations, [&db](int) {
+        return !db.getInvoicePage(InvoiceFilter(), InvoiceSummary(), 200).isEmpty();
+    });
+    measure("getInvoicePage.medicine", iterations, [&db, &random, &config](int) {
+        InvoiceFilter filter;
+        filter.medicineId = random.bounded(1, config.skus + 1);
+        db.getInvoicePage(filter, InvoiceSummary(), 200);
+        return true;
+    });
+    measure("getInvoiceDetails", iterations, [&db, &randomInvoiceId](int) {
+        return !db.getInvoiceDetails(randomInvoiceId()).isEmpty();
+    });
+    measure("getInvoiceDetails.batch50", iterations, [&db, &randomInvoiceId](int) {
+        QList<qint64> ids;
+        for (int i = 0; i < 50; ++i) ids.append(randomInvoiceId());
+        return !db.getInvoiceDetails(ids).isEmpty();
+    });
+    measure("getDailySales.30d", iterations, [&db, &today](int) {
+        db.getDailySales(today.addDays(-30), today);
+        return true;
+    });
+    measure("getTopMedicines.90d", iterations, [&db, &today](int) {
+        db.getTopMedicines(today.addDays(-90), today, 20);
+        return true;
+    });
+    measure("holdStock", iterations, [&db, &random, &config](int) {
+        return db.holdStock(random.bounded(1, config.skus + 1), 1).status == StockHold::Held;
+    });
+    db.releaseAllHolds();
+    measure("createInvoice", iterations, [&db, &random, &config](int) {
+        return db.createInvoice(Bench::randomCart(random, config)) != -1;
+    });
+
+    // Statement cache: the same SQL the hot paths send, fresh prepare vs reuse
+    const QSqlDatabase connection = QSqlDatabase::database(db.connectionName());
+    auto randomMedicineId = [&random, &config]() { return random.bounded(1, config.skus + 1); };
+    measurePrepared("statement.priceLookup", iterations, connection, "SELECT priceCents FROM Medicines WHERE id = ?",
+                    [&randomMedicineId]() { return QVariantList{randomMedicineId()}; });
+    measurePrepared("statement.idLookup", iterations, connection, "SELECT id FROM Medicines WHERE id = ?",
+                    [&randomMedicineId]() { return QVariantList{randomMedicineId()}; });
+    measurePrepared("statement.stockDecrement", iterations, connection,
+                    "UPDATE Medicines SET quantity = quantity - ? WHERE id = ? AND quantity >= ?",
+                    [&randomMedicineId]() { return QVariantList{1, randomMedicineId(), 1}; });
+    if (config.invoices > 0) {
+        measurePrepared("statement.invoiceItemInsert", iterations, connection,
+                        "INSERT INTO InvoiceItems (invoiceId, medicineId, quantitySold, priceAtSaleCents) VALUES (?, ?, ?, ?)",
+                        [&randomInvoiceId, &randomMedicineId]() {
+                            return QVariantList{randomInvoiceId(), randomMedicineId(), 1, 100};
+                        });
+    }
+
+    // Medicines that were never sold, so each deleteMedicine call really deletes one
+    QList<int> unsoldIds;
+    measure("addMedicine", iterations, [&db](int i) {
+        return db.addMedicine(QString("Unsold %1").arg(i), QString("UNSOLD-%1").arg(i), "2099-12-31", 1, 1.0);
+    });
+    QSqlQuery unsoldQuery(QSqlDatabase::database(db.connectionName()));
+    if (unsoldQuery.exec("SELECT id FROM Medicines WHERE batchNumber LIKE 'UNSOLD-%' ORDER BY id")) {
+        while (unsoldQuery.next()) unsoldIds.append(unsoldQuery.value(0).toInt());
+    }
+    unsoldQuery.finish();
+    measure("deleteMedicine", unsoldIds.size(), [&db, &unsoldIds](int i) { return db.deleteMedicine(unsoldIds.at(i)); });
+
+    return 0;
+}
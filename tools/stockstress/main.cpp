@@ -0,0 +1,189 @@
+#include "databasemanager.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QDebug>
+
+namespace {
+
+struct TerminalStats
+{
+    int sales = 0;
+    int conflicts = 0; // holds or checkouts refused for lack of stock
+    int failures = 0;  // database errors, e.g. busy timeouts
+    int units = 0;
+};
+
+// One simulated counter: reserve a small random cart, then check it out
+int runTerminal(const QString& databasePath, int terminal, int sales, int medicines)
+{
+    DatabaseManager db(QString("stress-%1").arg(terminal), databasePath);
+    db.setTerminalId(QString("terminal-%1").arg(terminal));
+    if (!db.initDatabase()) return 1;
+
+    TerminalStats stats;
+    QRandomGenerator *random = QRandomGenerator::global();
+    for (int sale = 0; sale < sales; ++sale) {
+        QHash<int, int> cart;
+        const int lines = random->bounded(1, 4);
+        bool refused = false;
+        for (int line = 0; line < lines && !refused; ++line) {
+            const int id = random->bounded(1, medicines + 1);
+            const int quantity = cart.value(id) + random->bounded(1, 4);
+            const StockHold hold = db.holdStock(id, quantity);
+            if (hold.status == StockHold::Held) {
+                cart.insert(id, quantity);
+            } else {
+                if (hold.status == StockHold::Failed) stats.failures++; else stats.conflicts++;
+                refused = true;
+            }
+        }
+        if (refused || cart.isEmpty()) {
+            db.releaseAllHolds();
+            continue;
+        }
+
+        QList<QPair<int, int>> items;
+        int units = 0;
+        for (auto it = cart.cbegin(); it != cart.cend(); ++it) {
+            items.append({it.key(), it.value()});
+            units += it.value();
+        }
+        QList<int> shortIds;
+        if (db.createInvoice(items, &shortIds) != -1) {
+            stats.sales++;
+            stats.units += units;
+        } else {
+            if (shortIds.isEmpty()) stats.failures++; else stats.conflicts++;
+            db.releaseAllHolds();
+        }
+    }
+
+    QTextStream(stdout) << "RESULT " << stats.sales << ' ' << stats.conflicts << ' '
+                        << stats.failures << ' ' << stats.units << Qt::endl;
+    return 0;
+}
+
+bool seedDatabase(const QString& databasePath, int medicines, int stock)
+{
+    DatabaseManager db("stress-seed", databasePath);
+    if (!db.initDatabase()) return false;
+    for (int i = 1; i <= medicines; ++i) {
+        if (!db.addMedicine(QString("Medicine %1").arg(i), QString("B%1").arg(i), "2099-12-31", stock, 1.0)) return false;
+    }
+    return true;
+}
+
+// Stock must never go negative, and what left the shelf must match what was invoiced
+bool verifyDatabase(const QString& databasePath, int stock, int expectedUnits)
+{
+    DatabaseManager db("stress-verify", databasePath);
+    if (!db.initDatabase()) return false;
+    QSqlQuery query(QSqlDatabase::database("stress-verify"));
+
+    bool ok = true;
+    if (query.exec("SELECT COUNT(*) FROM Medicines WHERE quantity < 0") && query.next() && query.value(0).toInt() > 0) {
+        qDebug() << "FAIL:" << query.value(0).toInt() << "medicines have negative stock";
+        ok = false;
+    }
+    if (!query.exec("SELECT m.id, m.quantity, COALESCE(SUM(i.quantitySold), 0) FROM Medicines m "
+                    "LEFT JOIN InvoiceItems i ON i.medicineId = m.id GROUP BY m.id")) {
+        qDebug() << "FAIL: could not read stock:" << query.lastError().text();
+        return false;
+    }
+    int soldUnits = 0;
+    while (query.next()) {
+        const int id = query.value(0).toInt();
+        const int quantity = query.value(1).toInt();
+        const int sold = query.value(2).toInt();
+        soldUnits += sold;
+        if (quantity + sold != stock) {
+            qDebug() << "FAIL: medicine" << id << "has" << quantity << "left after selling" << sold << "of" << stock;
+            ok = false;
+        }
+    }
+    if (soldUnits != expectedUnits) {
+        qDebug() << "FAIL: terminals reported" << expectedUnits << "units sold, invoices record" << soldUnits;
+        ok = false;
+    }
+    return ok;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs simulated checkout counters in parallel against one database.");
+    parser.addHelpOption();
+    QCommandLineOption terminalsOption("terminals", "Number of terminal processes.", "n", "8");
+    QCommandLineOption salesOption("sales", "Checkout attempts per terminal.", "n", "500");
+    QCommandLineOption medicinesOption("medicines", "Medicines in the seeded inventory.", "n", "20");
+    QCommandLineOption stockOption("stock", "Starting units per medicine.", "n", "200");
+    QCommandLineOption databaseOption("database", "New SQLite file to create (default: a temporary file).", "path");
+    QCommandLineOption workerOption("worker", "Internal: run as terminal n.", "n");
+    parser.addOptions({terminalsOption, salesOption, medicinesOption, stockOption, databaseOption, workerOption});
+    parser.process(app);
+
+    const int sales = parser.value(salesOption).toInt();
+    const int medicines = parser.value(medicinesOption).toInt();
+    if (parser.isSet(workerOption)) {
+        return runTerminal(parser.value(databaseOption), parser.value(workerOption).toInt(), sales, medicines);
+    }
+
+    const int terminals = parser.value(terminalsOption).toInt();
+    const int stock = parser.value(stockOption).toInt();
+    QTemporaryDir tempDir;
+    const QString databasePath = parser.isSet(databaseOption) ? parser.value(databaseOption)
+                                                              : tempDir.filePath("stockstress.db");
+    if (!seedDatabase(databasePath, medicines, stock)) {
+        qDebug() << "Could not seed" << databasePath;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<QProcess*> processes;
+    for (int t = 0; t < terminals; ++t) {
+        QProcess *process = new QProcess(&app);
+        process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process->start(QCoreApplication::applicationFilePath(),
+                       {"--worker", QString::number(t), "--database", databasePath,
+                        "--sales", QString::number(sales), "--medicines", QString::number(medicines)});
+        processes.append(process);
+    }
+
+    TerminalStats total;
+    bool ok = true;
+    for (QProcess *process : processes) {
+        process->waitForFinished(-1);
+        const QStringList fields = QString::fromUtf8(process->readAllStandardOutput()).trimmed().split(' ');
+        if (process->exitCode() != 0 || fields.size() != 5 || fields.first() != "RESULT") {
+            qDebug() << "FAIL: a terminal process did not finish cleanly";
+            ok = false;
+            continue;
+        }
+        total.sales += fields.at(1).toInt();
+        total.conflicts += fields.at(2).toInt();
+        total.failures += fields.at(3).toInt();
+        total.units += fields.at(4).toInt();
+    }
+    const double seconds = timer.elapsed() / 1000.0;
+
+    QTextStream(stdout) << "terminals " << terminals << ", " << total.sales << " sales (" << total.units << " units), "
+                        << total.conflicts << " stock conflicts, " << total.failures << " database errors in "
+                        << seconds << " s = " << (seconds > 0 ? total.sales / seconds : 0) << " sales/s" << Qt::endl;
+
+    ok = verifyDatabase(databasePath, stock, total.units) && ok;
+    QTextStream(stdout) << (ok ? "PASS: no negative stock, every sold unit invoiced" : "FAIL") << Qt::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+# Multi-terminal checkout stress harness: runs N simulated counters as separate
+# processes against one SQLite file and checks that stock never goes negative.
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../databasemanager.cpp \
+    ../../databaseprofile.cpp \
+    ../../metrics.cpp \
+    ../../schemamigrations.cpp \
+    ../../stockstore.cpp \
+    ../../tracing.cpp
+
+HEADERS += \
+    ../../databasemanager.h \
+    ../../databaseprofile.h \
+    ../../metrics.h \
+    ../../money.h \
+    ../../schemamigrations.h \
+    ../../stockstore.h \
+    ../../tracing.h
@@ -0,0 +1,167 @@
+#include "tracing.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QDebug>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> Tracing::detail::enabled{false};
+
+namespace {
+
+struct Event
+{
+    const char *category;
+    const char *name;
+    qint64 startUs;
+    qint64 durationUs;
+};
+
+// Written only by its thread while recording; read by stop()
+struct ThreadBuffer
+{
+    int tid = 0;
+    QString threadName;
+    QMutex mutex;          // uncontended except while stop() copies the events
+    std::vector<Event> events;
+    qint64 dropped = 0;
+};
+
+struct Recorder
+{
+    QMutex mutex;
+    QString path;
+    QElapsedTimer clock;
+    std::atomic<int> generation{0}; // bumped by start(), so buffers of an earlier trace are not reused
+    std::vector<std::shared_ptr<ThreadBuffer>> threads;
+};
+
+Recorder& recorder()
+{
+    static Recorder instance;
+    return instance;
+}
+
+ThreadBuffer *currentBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    thread_local int generation = -1;
+    Recorder& r = recorder();
+    if (buffer && generation == r.generation.load(std::memory_order_acquire)) return buffer.get();
+
+    // First event of this thread in this trace
+    QMutexLocker locker(&r.mutex);
+    if (!buffer || generation != r.generation.load()) {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->tid = int(r.threads.size()) + 1;
+        QThread *thread = QThread::currentThread();
+        buffer->threadName = thread->objectName();
+        if (buffer->threadName.isEmpty()) {
+            const bool mainThread = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+            buffer->threadName = mainThread ? QString("Main") : QString("Thread %1").arg(buffer->tid);
+        }
+        r.threads.push_back(buffer);
+        generation = r.generation.load();
+    }
+    return buffer.get();
+}
+
+// utf8 is copied as is apart from the characters JSON requires escaped
+void appendJsonString(QByteArray& out, QByteArrayView utf8)
+{
+    out += '"';
+    for (char c : utf8) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (uchar(c) < 0x20) {
+            out += QByteArray("\\u00") + QByteArray::number(uchar(c), 16).rightJustified(2, '0');
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+}
+
+bool Tracing::start(const QString& path)
+{
+    Recorder& r = recorder();
+    QMutexLocker locker(&r.mutex);
+    if (detail::enabled.load()) return false;
+    r.path = path;
+    r.threads.clear();
+    r.generation.fetch_add(1);
+    r.clock.start();
+    detail::enabled.store(true);
+    return true;
+}
+
+qint64 Tracing::nowUs()
+{
+    return recorder().clock.nsecsElapsed() / 1000;
+}
+
+void Tracing::complete(const char *category, const char *name, qint64 startUs, qint64 durationUs)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer *buffer = currentBuffer();
+    QMutexLocker locker(&buffer->mutex);
+    if (buffer->events.size() >= size_t(MaxEventsPerThread)) {
+        buffer->dropped++;
+        return;
+    }
+    buffer->events.push_back({category, name, startUs, durationUs});
+}
+
+bool Tracing::stop()
+{
+    Recorder& r = recorder();
+    QMutexLocker locker(&r.mutex);
+    if (!detail::enabled.exchange(false)) return true;
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&out, &first]() {
+        if (!first) out += ",\n";
+        first = false;
+    };
+    for (const auto& buffer : r.threads) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        separator();
+        out += QString("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":")
+                   .arg(pid).arg(buffer->tid).toUtf8();
+        appendJsonString(out, buffer->threadName.toUtf8());
+        out += "}}";
+        for (const Event& event : buffer->events) {
+            separator();
+            out += "{\"ph\":\"X\",\"cat\":";
+            appendJsonString(out, event.category);
+            out += ",\"name\":";
+            appendJsonString(out, event.name);
+            out += QString(",\"ts\":%1,\"dur\":%2,\"pid\":%3,\"tid\":%4}")
+                       .arg(event.startUs).arg(event.durationUs).arg(pid).arg(buffer->tid).toUtf8();
+        }
+        if (buffer->dropped > 0) {
+            separator();
+            out += QString("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"dropped %1 events\",\"ts\":%2,\"pid\":%3,\"tid\":%4}")
+                       .arg(buffer->dropped).arg(nowUs()).arg(pid).arg(buffer->tid).toUtf8();
+        }
+        buffer->events = std::vector<Event>();
+    }
+    out += "\n]}\n";
+    r.threads.clear();
+
+    QSaveFile file(r.path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit()) {
+        qDebug() << "Failed to write trace" << r.path << file.errorString();
+        return false;
+    }
+    qDebug() << "Trace written to" << r.path;
+    return true;
+}
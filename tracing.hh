@@ -0,0 +1,72 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <atomic>
+
+// Scoped spans written as Chrome trace-event JSON, which chrome://tracing and
+// ui.perfetto.dev open directly.
+//
+// Recording is off unless Tracing::start() was called (main() does so for
+// --trace <file> or MEDICARE_TRACE=<file>). While it is off a span costs one
+// relaxed atomic load. While it is on, each thread appends to a buffer of its
+// own, and the file is written once by Tracing::stop().
+//
+//     void DatabaseManager::addStock(...)
+//     {
+//         TRACE_SCOPE("db", "DatabaseManager::addStock");
+//
+// Category and name must be string literals (or otherwise outlive the trace).
+namespace Tracing {
+
+// Events kept per thread; later ones are dropped and counted in the file
+constexpr int MaxEventsPerThread = 1 << 20;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+// Starts recording events for path; false if already recording
+bool start(const QString& path);
+// Stops recording and writes the file; false if it could not be written
+bool stop();
+
+// Microseconds since start()
+qint64 nowUs();
+// Records a span measured by the caller, e.g. one that ends in another slot
+void complete(const char *category, const char *name, qint64 startUs, qint64 durationUs);
+
+}
+
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name)
+    {
+        if (Tracing::isEnabled()) {
+            m_category = category;
+            m_name = name;
+            m_startUs = Tracing::nowUs();
+        }
+    }
+    ~TraceSpan()
+    {
+        if (m_name) Tracing::complete(m_category, m_name, m_startUs, Tracing::nowUs() - m_startUs);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char *m_category = nullptr;
+    const char *m_name = nullptr;
+    qint64 m_startUs = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Spans the rest of the enclosing block
+#define TRACE_SCOPE(category, name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+
+#endif // TRACING_H